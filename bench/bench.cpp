@@ -0,0 +1,275 @@
+// Host benchmark and regression check for the parse and render paths.
+//
+//   pio run -e native && .pio/build/native/program [payload-dir]
+//
+// Replays the responses in bench/payloads through the real timer classes,
+// with only the HAL underneath mocked (bench/mock), and reports parse time,
+// arena use and LCD traffic. Exits non-zero when a result is wrong or a
+// memory or I2C budget is exceeded, so a change that breaks parsing or
+// starts redrawing the whole screen fails the run. Host timings only compare
+// one build with another; they are several times faster than the ESP32.
+
+#include <Arduino.h>
+#include <LiquidCrystal_I2C.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "button_input.h"
+#include "clock_sync.h"
+#include "json_arena.h"
+#include "metrics.h"
+#include "timer_display.h"
+#include "timers.h"
+
+#define BENCH_DEFAULT_PAYLOAD_DIR "bench/payloads"
+#define BENCH_ITERATIONS 200
+#define BENCH_RENDER_SECONDS (6 * 60 * 60)
+#define BENCH_RENDER_SWITCH_SECONDS 600 // Move to the next timer this often
+// Each LCD byte goes out as two nibbles, three PCF8574 writes of about 20
+// bits each at 100 kHz plus the enable pulse delays
+#define LCD_I2C_US_PER_BYTE 1300
+// Budgets: a one-second tick should rewrite a digit or two, not the screen
+#define RENDER_MAX_BYTES_PER_TICK 4
+
+// What the fixtures decode to
+#define GITHUB_EXPECTED_EVENT 1732125845  // 2024-11-20T18:04:05Z
+#define BLUESKY_EXPECTED_POST 1732125511  // 2024-11-20T17:58:31.402Z
+#define WEATHER_EXPECTED_THAW 1732122000  // Last hourly reading above zero
+
+ConnectionPool connectionPool;
+
+// Polls run inline here, never through a queue
+bool queuePoll(PollingTimer *)
+{
+  return false;
+}
+
+struct PollCase
+{
+  const char *name;
+  size_t payloadBytes;
+  size_t arenaBudget;
+  time_t expected;
+  // Fresh timer per iteration, or one timer polled repeatedly
+  PollingTimer *(*create)();
+  bool reuse;
+};
+
+struct PollResult
+{
+  uint32_t medianUs;
+  uint32_t p99Us;
+  size_t highWater;
+  bool ok;
+};
+
+static int failures = 0;
+
+static void fail(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+static void fail(const char *format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  printf("FAIL: ");
+  vprintf(format, args);
+  printf("\n");
+  va_end(args);
+  failures++;
+}
+
+static std::string readPayload(const std::string &dir, const char *name)
+{
+  std::ifstream file(dir + "/" + name, std::ios::binary);
+  if (!file)
+  {
+    fail("cannot read %s/%s", dir.c_str(), name);
+    return std::string();
+  }
+  std::ostringstream contents;
+  contents << file.rdbuf();
+  return contents.str();
+}
+
+static PollResult runPolls(const PollCase &test)
+{
+  std::vector<uint32_t> samples;
+  samples.reserve(BENCH_ITERATIONS);
+  PollResult result = {0, 0, 0, true};
+
+  JsonArena arena;
+  arena.begin();
+  PollingTimer *shared = test.reuse ? test.create() : nullptr;
+  if (shared != nullptr)
+  {
+    // The first poll primes validators and history; only later ones are timed
+    shared->poll(arena);
+    arena.reset();
+  }
+
+  for (int i = 0; i < BENCH_ITERATIONS && result.ok; i++)
+  {
+    PollingTimer *timer = shared != nullptr ? shared : test.create();
+    uint32_t start = micros();
+    bool polled = timer->poll(arena);
+    samples.push_back(micros() - start);
+    arena.reset();
+
+    if (!polled || timer->getLastTriggerTime() != test.expected)
+    {
+      fail("%s: poll %s, trigger time %ld, expected %ld", test.name, polled ? "succeeded" : "failed",
+           (long)timer->getLastTriggerTime(), (long)test.expected);
+      result.ok = false;
+    }
+    if (timer != shared)
+    {
+      delete timer;
+    }
+  }
+  delete shared;
+
+  if (arena.getFailures() > 0)
+  {
+    fail("%s: arena ran out %u times", test.name, (unsigned)arena.getFailures());
+    result.ok = false;
+  }
+  result.highWater = arena.getHighWater();
+  if (result.highWater > test.arenaBudget)
+  {
+    fail("%s: arena high water %u exceeds budget %u", test.name, (unsigned)result.highWater,
+         (unsigned)test.arenaBudget);
+    result.ok = false;
+  }
+
+  std::sort(samples.begin(), samples.end());
+  if (!samples.empty())
+  {
+    result.medianUs = samples[samples.size() / 2];
+    result.p99Us = samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+  }
+  return result;
+}
+
+// Steps the display through simulated seconds and counts what reaches the LCD
+static void runRender(Timer **timers, uint8_t count)
+{
+  LiquidCrystal_I2C lcd(0x27, LCD_COLS, LCD_ROWS);
+  ButtonInput buttons(50);
+  ClockSync clock;
+  clock.begin(0, 0, "pool.ntp.org");
+  LatencyHistogram lcdWrite;
+  TimerDisplay display(timers, count, buttons, clock, lcd, lcdWrite);
+
+  time_t base = time(nullptr);
+  display.update(base);
+  uint32_t firstFrame = lcd.getCommands() + lcd.getCharacters();
+  lcd.resetCounts();
+
+  uint32_t start = micros();
+  for (int32_t second = 1; second <= BENCH_RENDER_SECONDS; second++)
+  {
+    if (second % BENCH_RENDER_SWITCH_SECONDS == 0)
+    {
+      display.nextTimer();
+    }
+    display.update(base + second);
+  }
+  uint32_t elapsedUs = micros() - start;
+
+  uint32_t bytes = lcd.getCommands() + lcd.getCharacters();
+  double perTick = (double)bytes / BENCH_RENDER_SECONDS;
+  printf("%-18s %8.2f us/tick %6.2f bytes/tick  ~%5.0f us I2C/tick  first frame %u bytes\n", "render",
+         (double)elapsedUs / BENCH_RENDER_SECONDS, perTick, perTick * LCD_I2C_US_PER_BYTE, (unsigned)firstFrame);
+
+  if (perTick > RENDER_MAX_BYTES_PER_TICK)
+  {
+    fail("render: %.2f bytes per tick exceeds budget %d", perTick, RENDER_MAX_BYTES_PER_TICK);
+  }
+}
+
+static PollingTimer *createGitHub()
+{
+  return new GitHubPollingTimer("GitHub Push", "octocat");
+}
+
+static PollingTimer *createBluesky()
+{
+  return new BlueskyPollingTimer("Bluesky Post", "octocat.bsky.social");
+}
+
+static PollingTimer *createWeather()
+{
+  return new WeatherPollingTimer("Above Zero", 51.05f, -114.06f);
+}
+
+int main(int argc, char **argv)
+{
+  std::string dir = argc > 1 ? argv[1] : BENCH_DEFAULT_PAYLOAD_DIR;
+  connectionPool.begin();
+  std::string github = readPayload(dir, "github_events.json");
+  std::string bluesky = readPayload(dir, "bluesky_records.json");
+  std::string blueskyResolve = readPayload(dir, "bluesky_resolve.json");
+  std::string blueskyDid = readPayload(dir, "bluesky_did.json");
+  std::string weatherCurrent = readPayload(dir, "weather_current.json");
+  std::string weatherHistory = readPayload(dir, "weather_history.json");
+  if (failures > 0)
+  {
+    return 1;
+  }
+
+  // Headers as each provider sends them; the quota is far from exhausted so
+  // repeated polls are never deferred. The more specific route comes first.
+  char reset[16];
+  snprintf(reset, sizeof(reset), "%ld", (long)time(nullptr) + 3600);
+  replayRoute({"api.github.com", HTTP_CODE_OK,
+               {{"ETag", "W/\"5c1fd9b87a4e\""}, {"X-RateLimit-Remaining", "59"}, {"X-RateLimit-Reset", reset}},
+               github, false});
+  replayRoute({"resolveHandle", HTTP_CODE_OK, {}, blueskyResolve, false});
+  replayRoute({"plc.directory", HTTP_CODE_OK, {}, blueskyDid, false});
+  replayRoute({"listRecords", HTTP_CODE_OK, {{"RateLimit-Remaining", "2999"}, {"RateLimit-Reset", "300"}},
+               bluesky, true});
+  replayRoute({"hourly=", HTTP_CODE_OK, {}, weatherHistory, true});
+  replayRoute({"api.open-meteo.com", HTTP_CODE_OK, {}, weatherCurrent, true});
+
+  // Polls without PSRAM have to fit the internal arena; only history needs more
+  const PollCase cases[] = {
+      {"github", github.size(), JSON_ARENA_INTERNAL_SIZE, GITHUB_EXPECTED_EVENT, createGitHub, false},
+      {"github 304", 0, JSON_ARENA_INTERNAL_SIZE, GITHUB_EXPECTED_EVENT, createGitHub, true},
+      {"bluesky resolve", bluesky.size(), JSON_ARENA_INTERNAL_SIZE, BLUESKY_EXPECTED_POST, createBluesky, false},
+      {"bluesky", bluesky.size(), JSON_ARENA_INTERNAL_SIZE, BLUESKY_EXPECTED_POST, createBluesky, true},
+      {"weather current", weatherCurrent.size(), JSON_ARENA_INTERNAL_SIZE, WEATHER_EXPECTED_THAW, createWeather, true},
+      {"weather history", weatherHistory.size(), JSON_ARENA_PSRAM_SIZE, WEATHER_EXPECTED_THAW, createWeather, false},
+  };
+
+  printf("%-18s %10s %10s %10s %12s\n", "case", "median us", "p99 us", "MB/s", "arena peak");
+  for (const PollCase &test : cases)
+  {
+    PollResult result = runPolls(test);
+    double throughput = result.medianUs > 0 ? (double)test.payloadBytes / result.medianUs : 0.0;
+    printf("%-18s %10u %10u %10.1f %12u\n", test.name, (unsigned)result.medianUs, (unsigned)result.p99Us,
+           throughput, (unsigned)result.highWater);
+  }
+
+  GitHubPollingTimer githubTimer("GitHub Push", "octocat", 300, time(nullptr) - 3 * 60 * 60);
+  ButtonTimer buttonTimer("Last Coffee", time(nullptr) - 42);
+  WeatherPollingTimer weatherTimer("Above Zero", 51.05f, -114.06f);
+  // As if already polled, so they show times rather than the sync placeholder
+  TimerState polled = {};
+  polled.lastPollTime = time(nullptr);
+  polled.lastTriggerTime = githubTimer.getLastTriggerTime();
+  githubTimer.restoreState(polled);
+  polled.lastTriggerTime = weatherTimer.getLastTriggerTime();
+  weatherTimer.restoreState(polled);
+  Timer *timers[] = {&githubTimer, &buttonTimer, &weatherTimer};
+  runRender(timers, sizeof(timers) / sizeof(timers[0]));
+
+  if (failures > 0)
+  {
+    printf("%d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("All checks passed\n");
+  return 0;
+}
@@ -0,0 +1,80 @@
+#ifndef BENCH_ARDUINO_H
+#define BENCH_ARDUINO_H
+
+// Host stand-in for the ESP32 Arduino core: enough for the firmware headers
+// to build natively, with a real clock and stdout for Serial.
+
+#include <ctype.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <chrono>
+#include "Stream.h"
+#include "WString.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define IRAM_ATTR
+#define HIGH 1
+#define LOW 0
+#define INPUT 1
+#define INPUT_PULLUP 5
+
+inline uint64_t benchMicros()
+{
+  static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline unsigned long millis() { return (unsigned long)(benchMicros() / 1000); }
+inline unsigned long micros() { return (unsigned long)benchMicros(); }
+inline void delay(uint32_t) {}
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return HIGH; }
+
+inline bool isDigit(int c) { return c >= '0' && c <= '9'; }
+inline bool isHexadecimalDigit(int c) { return isxdigit(c) != 0; }
+
+// Deterministic so backoff jitter is the same on every run
+inline uint32_t esp_random()
+{
+  static uint32_t state = 0x12345678;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+inline void configTime(long, int, const char *, const char * = nullptr, const char * = nullptr) {}
+
+class HardwareSerial : public Stream
+{
+public:
+  void begin(unsigned long) {}
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  size_t write(uint8_t c) override { return fputc(c, stdout) == EOF ? 0 : 1; }
+  size_t write(const uint8_t *buffer, size_t size) override { return fwrite(buffer, 1, size, stdout); }
+
+  size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)))
+  {
+    va_list args;
+    va_start(args, format);
+    int n = vprintf(format, args);
+    va_end(args);
+    return n < 0 ? 0 : n;
+  }
+
+  size_t println(const char *text = "") { return ::printf("%s\n", text); }
+};
+
+inline HardwareSerial Serial;
+
+#endif
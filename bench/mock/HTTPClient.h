@@ -0,0 +1,190 @@
+#ifndef BENCH_HTTP_CLIENT_H
+#define BENCH_HTTP_CLIENT_H
+
+#include "Arduino.h"
+#include "WiFiClientSecure.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+#define HTTP_CODE_OK 200
+#define HTTP_CODE_NO_CONTENT 204
+#define HTTP_CODE_NOT_MODIFIED 304
+#define HTTP_CODE_TOO_MANY_REQUESTS 429
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+
+// A canned reply served to every URL containing match. Chunked bodies are
+// framed here so the firmware's chunk decoder runs as it does on the device.
+struct ReplayResponse
+{
+  std::string match;
+  int status;
+  std::vector<std::pair<std::string, std::string>> headers;
+  std::string body;
+  bool chunked;
+};
+
+inline std::vector<ReplayResponse> &replayRoutes()
+{
+  static std::vector<ReplayResponse> routes;
+  return routes;
+}
+
+inline void replayRoute(const ReplayResponse &response)
+{
+  replayRoutes().push_back(response);
+}
+
+// Reads from an in-memory buffer, as the TLS client would from the socket
+class ReplayStream : public Stream
+{
+private:
+  std::string data;
+  size_t pos;
+
+public:
+  ReplayStream() : pos(0) {}
+
+  void load(const std::string &bytes)
+  {
+    data = bytes;
+    pos = 0;
+  }
+
+  int available() override { return (int)(data.size() - pos); }
+  int read() override { return pos < data.size() ? (uint8_t)data[pos++] : -1; }
+  int peek() override { return pos < data.size() ? (uint8_t)data[pos] : -1; }
+  size_t write(uint8_t) override { return 0; }
+
+  using Stream::readBytes;
+
+  size_t readBytes(char *buffer, size_t length) override
+  {
+    size_t n = std::min(length, data.size() - pos);
+    memcpy(buffer, data.data() + pos, n);
+    pos += n;
+    return n;
+  }
+};
+
+class HTTPClient
+{
+private:
+  std::string url;
+  std::vector<std::pair<std::string, std::string>> requestHeaders;
+  const ReplayResponse *response;
+  ReplayStream stream;
+
+  static std::string frameChunks(const std::string &body)
+  {
+    static const size_t CHUNK_SIZE = 1024;
+    std::string framed;
+    char line[16];
+    for (size_t pos = 0; pos < body.size(); pos += CHUNK_SIZE)
+    {
+      size_t length = std::min(CHUNK_SIZE, body.size() - pos);
+      snprintf(line, sizeof(line), "%zx\r\n", length);
+      framed += line;
+      framed.append(body, pos, length);
+      framed += "\r\n";
+    }
+    framed += "0\r\n\r\n";
+    return framed;
+  }
+
+  std::string requestHeader(const char *name) const
+  {
+    for (const auto &header : requestHeaders)
+    {
+      if (strcasecmp(header.first.c_str(), name) == 0)
+      {
+        return header.second;
+      }
+    }
+    return std::string();
+  }
+
+public:
+  HTTPClient() : response(nullptr) {}
+
+  void setReuse(bool) {}
+  void setTimeout(uint16_t) {}
+  void collectHeaders(const char **, size_t) {}
+
+  bool begin(WiFiClientSecure &, const char *target)
+  {
+    url = target;
+    requestHeaders.clear();
+    response = nullptr;
+    return true;
+  }
+
+  void addHeader(const char *name, const char *value)
+  {
+    requestHeaders.emplace_back(name, value);
+  }
+
+  // Honours If-None-Match against the route's ETag, like the real APIs
+  int GET()
+  {
+    for (const ReplayResponse &route : replayRoutes())
+    {
+      if (url.find(route.match) != std::string::npos)
+      {
+        response = &route;
+        break;
+      }
+    }
+    if (response == nullptr)
+    {
+      return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+
+    std::string validator = requestHeader("If-None-Match");
+    if (!validator.empty() && validator == header("ETag").c_str())
+    {
+      stream.load(std::string());
+      return HTTP_CODE_NOT_MODIFIED;
+    }
+
+    stream.load(response->chunked ? frameChunks(response->body) : response->body);
+    return response->status;
+  }
+
+  String header(const char *name) const
+  {
+    if (response == nullptr)
+    {
+      return String();
+    }
+    if (response->chunked && strcasecmp(name, "Transfer-Encoding") == 0)
+    {
+      return String("chunked");
+    }
+    for (const auto &header : response->headers)
+    {
+      if (strcasecmp(header.first.c_str(), name) == 0)
+      {
+        return String(header.second);
+      }
+    }
+    return String();
+  }
+
+  Stream *getStreamPtr()
+  {
+    return &stream;
+  }
+
+  int getSize() const
+  {
+    return response == nullptr || response->chunked ? -1 : (int)response->body.size();
+  }
+
+  void end()
+  {
+    response = nullptr;
+  }
+};
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef BENCH_LIQUID_CRYSTAL_I2C_H
+#define BENCH_LIQUID_CRYSTAL_I2C_H
+
+#include "Arduino.h"
+
+// Keeps the bytes a real LCD would receive instead of sending them over I2C
+class LiquidCrystal_I2C
+{
+private:
+  uint32_t commands;
+  uint32_t characters;
+
+public:
+  LiquidCrystal_I2C(uint8_t, uint8_t, uint8_t) : commands(0), characters(0) {}
+
+  void init() {}
+  void backlight() {}
+  void noBacklight() {}
+  void clear() { commands++; }
+  void setCursor(uint8_t, uint8_t) { commands++; }
+
+  size_t write(uint8_t)
+  {
+    characters++;
+    return 1;
+  }
+
+  uint32_t getCommands() const { return commands; }
+  uint32_t getCharacters() const { return characters; }
+
+  void resetCounts()
+  {
+    commands = 0;
+    characters = 0;
+  }
+};
+
+#endif
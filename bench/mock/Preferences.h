@@ -0,0 +1,75 @@
+#ifndef BENCH_PREFERENCES_H
+#define BENCH_PREFERENCES_H
+
+#include <stdint.h>
+#include <string.h>
+#include <map>
+#include <string>
+
+// NVS in memory: every namespace starts empty on each run
+class Preferences
+{
+private:
+  std::string prefix;
+
+  static std::map<std::string, std::string> &store()
+  {
+    static std::map<std::string, std::string> values;
+    return values;
+  }
+
+  std::string keyFor(const char *key) const
+  {
+    return prefix + "/" + key;
+  }
+
+public:
+  bool begin(const char *name, bool = false)
+  {
+    prefix = name;
+    return true;
+  }
+
+  void end() {}
+
+  size_t putBytes(const char *key, const void *value, size_t length)
+  {
+    store()[keyFor(key)].assign(static_cast<const char *>(value), length);
+    return length;
+  }
+
+  size_t getBytesLength(const char *key)
+  {
+    auto found = store().find(keyFor(key));
+    return found == store().end() ? 0 : found->second.size();
+  }
+
+  size_t getBytes(const char *key, void *buffer, size_t length)
+  {
+    auto found = store().find(keyFor(key));
+    if (found == store().end() || found->second.size() > length)
+    {
+      return 0;
+    }
+    memcpy(buffer, found->second.data(), found->second.size());
+    return found->second.size();
+  }
+
+  size_t putLong64(const char *key, int64_t value)
+  {
+    return putBytes(key, &value, sizeof(value));
+  }
+
+  int64_t getLong64(const char *key, int64_t fallback = 0)
+  {
+    int64_t value = fallback;
+    return getBytes(key, &value, sizeof(value)) == sizeof(value) ? value : fallback;
+  }
+
+  bool remove(const char *key)
+  {
+    return store().erase(keyFor(key)) > 0;
+  }
+};
+
+#endif
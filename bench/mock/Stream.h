@@ -0,0 +1,54 @@
+#ifndef BENCH_STREAM_H
+#define BENCH_STREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+class Print
+{
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size)
+  {
+    size_t n = 0;
+    while (n < size && write(buffer[n]) == 1)
+    {
+      n++;
+    }
+    return n;
+  }
+};
+
+// Reads never wait: a mock source either has the bytes or has ended
+class Stream : public Print
+{
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long) {}
+
+  virtual size_t readBytes(char *buffer, size_t length)
+  {
+    size_t n = 0;
+    for (; n < length; n++)
+    {
+      int c = read();
+      if (c < 0)
+      {
+        break;
+      }
+      buffer[n] = (char)c;
+    }
+    return n;
+  }
+
+  size_t readBytes(uint8_t *buffer, size_t length)
+  {
+    return readBytes(reinterpret_cast<char *>(buffer), length);
+  }
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef BENCH_WSTRING_H
+#define BENCH_WSTRING_H
+
+#include <string.h>
+#include <strings.h>
+#include <string>
+
+// The subset of Arduino's String used by the firmware headers
+class String
+{
+private:
+  std::string value;
+
+public:
+  String(const char *text = "") : value(text != nullptr ? text : "") {}
+  String(const std::string &text) : value(text) {}
+
+  const char *c_str() const { return value.c_str(); }
+  unsigned int length() const { return value.length(); }
+  bool isEmpty() const { return value.empty(); }
+
+  bool equalsIgnoreCase(const String &other) const
+  {
+    return strcasecmp(value.c_str(), other.c_str()) == 0;
+  }
+
+  bool startsWith(const String &prefix) const
+  {
+    return value.compare(0, prefix.value.size(), prefix.value) == 0;
+  }
+
+  String substring(unsigned int from) const
+  {
+    return from < value.size() ? String(value.substr(from)) : String();
+  }
+
+  String substring(unsigned int from, unsigned int to) const
+  {
+    return from < value.size() ? String(value.substr(from, to - from)) : String();
+  }
+
+  long toInt() const { return strtol(value.c_str(), nullptr, 10); }
+
+  bool operator==(const String &other) const { return value == other.value; }
+  bool operator!=(const String &other) const { return value != other.value; }
+  bool operator==(const char *other) const { return value == other; }
+  bool operator!=(const char *other) const { return value != other; }
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef BENCH_WIFI_H
+#define BENCH_WIFI_H
+
+#include "Arduino.h"
+
+#define WL_IDLE_STATUS 0
+#define WL_CONNECTED 3
+#define WL_DISCONNECTED 6
+
+class IPAddress
+{
+private:
+  uint8_t octets[4];
+
+public:
+  IPAddress() : octets{0, 0, 0, 0} {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : octets{a, b, c, d} {}
+
+  uint8_t operator[](int i) const { return octets[i]; }
+  operator uint32_t() const { return octets[0] | octets[1] << 8 | octets[2] << 16 | (uint32_t)octets[3] << 24; }
+
+  String toString() const
+  {
+    char text[16];
+    snprintf(text, sizeof(text), "%u.%u.%u.%u", octets[0], octets[1], octets[2], octets[3]);
+    return String(text);
+  }
+};
+
+// Always associated; every host resolves to a documentation address
+class WiFiClass
+{
+public:
+  int status() const { return WL_CONNECTED; }
+
+  int hostByName(const char *, IPAddress &result)
+  {
+    result = IPAddress(192, 0, 2, 1);
+    return 1;
+  }
+
+  IPAddress localIP() const { return IPAddress(192, 0, 2, 100); }
+
+  // No resolver, so lookups go straight to hostByName()
+  IPAddress dnsIP(uint8_t = 0) const { return IPAddress(); }
+};
+
+inline WiFiClass WiFi;
+
+#endif
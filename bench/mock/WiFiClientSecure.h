@@ -0,0 +1,28 @@
+#ifndef BENCH_WIFI_CLIENT_SECURE_H
+#define BENCH_WIFI_CLIENT_SECURE_H
+
+#include "WiFi.h"
+
+// Connections open instantly and stay open until stopped, so the pool's
+// keep-alive path is what the bench measures after the first request
+class WiFiClientSecure
+{
+private:
+  bool open;
+
+public:
+  WiFiClientSecure() : open(false) {}
+
+  void setInsecure() {}
+
+  int connect(IPAddress, uint16_t, const char *, const char *, const char *, const char *)
+  {
+    open = true;
+    return 1;
+  }
+
+  bool connected() const { return open; }
+  void stop() { open = false; }
+};
+
+#endif
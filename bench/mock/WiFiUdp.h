@@ -0,0 +1,18 @@
+#ifndef BENCH_WIFIUDP_H
+#define BENCH_WIFIUDP_H
+
+#include "WiFi.h"
+
+// Never reached: the mock Wi-Fi reports no DNS server
+class WiFiUDP
+{
+public:
+  int beginPacket(IPAddress, uint16_t) { return 0; }
+  size_t write(const uint8_t *, size_t) { return 0; }
+  int endPacket() { return 0; }
+  int parsePacket() { return 0; }
+  int read(uint8_t *, size_t) { return 0; }
+  void stop() {}
+};
+
+#endif
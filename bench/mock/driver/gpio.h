@@ -0,0 +1,27 @@
+#ifndef BENCH_DRIVER_GPIO_H
+#define BENCH_DRIVER_GPIO_H
+
+#include <stdint.h>
+
+typedef int gpio_num_t;
+typedef int esp_err_t;
+typedef enum
+{
+  GPIO_INTR_DISABLE,
+  GPIO_INTR_POSEDGE,
+  GPIO_INTR_NEGEDGE,
+  GPIO_INTR_ANYEDGE,
+  GPIO_INTR_LOW_LEVEL,
+  GPIO_INTR_HIGH_LEVEL
+} gpio_int_type_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+// Pins never change; the bench drives the display without button edges
+inline esp_err_t gpio_install_isr_service(int) { return ESP_OK; }
+inline esp_err_t gpio_isr_handler_add(gpio_num_t, void (*)(void *), void *) { return ESP_OK; }
+inline esp_err_t gpio_wakeup_enable(gpio_num_t, gpio_int_type_t) { return ESP_OK; }
+inline esp_err_t gpio_intr_enable(gpio_num_t) { return ESP_OK; }
+
+#endif
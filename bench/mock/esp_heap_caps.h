@@ -0,0 +1,17 @@
+#ifndef BENCH_ESP_HEAP_CAPS_H
+#define BENCH_ESP_HEAP_CAPS_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+
+// Every capability is plain heap on the host, so JsonArena gets its PSRAM size
+inline void *heap_caps_malloc(size_t size, uint32_t)
+{
+  return malloc(size);
+}
+
+#endif
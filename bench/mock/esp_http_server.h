@@ -0,0 +1,63 @@
+#ifndef BENCH_ESP_HTTP_SERVER_H
+#define BENCH_ESP_HTTP_SERVER_H
+
+#include "Arduino.h"
+
+// Only referenced by the local server and metrics writer, which the bench never serves
+typedef int esp_err_t;
+#ifndef ESP_OK
+#define ESP_OK 0
+#endif
+typedef void *httpd_handle_t;
+
+typedef enum
+{
+  HTTP_DELETE,
+  HTTP_GET,
+  HTTP_HEAD,
+  HTTP_POST,
+  HTTP_PUT
+} httpd_method_t;
+
+#define HTTPD_RESP_USE_STRLEN -1
+#define HTTPD_SOCK_ERR_TIMEOUT -3
+
+struct httpd_req_t
+{
+  size_t content_len;
+  void *user_ctx;
+};
+
+struct httpd_uri_t
+{
+  const char *uri;
+  httpd_method_t method;
+  esp_err_t (*handler)(httpd_req_t *);
+  void *user_ctx;
+};
+
+struct httpd_config_t
+{
+  unsigned task_priority;
+  size_t stack_size;
+  int core_id;
+  uint16_t server_port;
+  uint16_t max_uri_handlers;
+  bool lru_purge_enable;
+};
+
+#define HTTPD_DEFAULT_CONFIG() httpd_config_t{}
+
+inline esp_err_t httpd_start(httpd_handle_t *, const httpd_config_t *) { return ESP_OK; }
+inline esp_err_t httpd_register_uri_handler(httpd_handle_t, const httpd_uri_t *) { return ESP_OK; }
+inline size_t httpd_req_get_hdr_value_len(httpd_req_t *, const char *) { return 0; }
+inline esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *, const char *, char *, size_t) { return -1; }
+inline esp_err_t httpd_req_get_url_query_str(httpd_req_t *, char *, size_t) { return -1; }
+inline esp_err_t httpd_query_key_value(const char *, const char *, char *, size_t) { return -1; }
+inline int httpd_req_recv(httpd_req_t *, char *, size_t) { return -1; }
+inline esp_err_t httpd_resp_set_status(httpd_req_t *, const char *) { return ESP_OK; }
+inline esp_err_t httpd_resp_set_type(httpd_req_t *, const char *) { return ESP_OK; }
+inline esp_err_t httpd_resp_send(httpd_req_t *, const char *, long) { return ESP_OK; }
+inline esp_err_t httpd_resp_send_chunk(httpd_req_t *, const char *, long) { return ESP_OK; }
+
+#endif
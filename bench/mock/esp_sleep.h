@@ -0,0 +1,8 @@
+#ifndef BENCH_ESP_SLEEP_H
+#define BENCH_ESP_SLEEP_H
+
+#include "driver/gpio.h"
+
+inline esp_err_t esp_sleep_enable_gpio_wakeup() { return ESP_OK; }
+
+#endif
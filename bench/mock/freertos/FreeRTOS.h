@@ -0,0 +1,29 @@
+#ifndef BENCH_FREERTOS_H
+#define BENCH_FREERTOS_H
+
+#include <stdint.h>
+
+// The bench is single-threaded, so locks and notifications do nothing
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdFAIL 0
+#define pdPASS 1
+#define portMAX_DELAY 0xffffffffu
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define tskNO_AFFINITY 0x7fffffff
+
+typedef struct
+{
+  uint32_t owner;
+} portMUX_TYPE;
+#define portMUX_INITIALIZE(mux) ((mux)->owner = 0)
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+#define portYIELD_FROM_ISR()
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef BENCH_FREERTOS_TASK_H
+#define BENCH_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+// No task ever starts, so anything handed to a task has to be driven directly
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return nullptr; }
+inline BaseType_t xTaskCreate(TaskFunction_t, const char *, uint32_t, void *, uint32_t, TaskHandle_t *) { return pdFAIL; }
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char *, uint32_t, void *, uint32_t,
+                                          TaskHandle_t *, BaseType_t) { return pdFAIL; }
+inline BaseType_t xTaskNotifyGive(TaskHandle_t) { return pdPASS; }
+inline void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t *) {}
+inline uint32_t ulTaskNotifyTake(BaseType_t, TickType_t) { return 0; }
+inline void vTaskDelay(TickType_t) {}
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef BENCH_HAL_GPIO_LL_H
+#define BENCH_HAL_GPIO_LL_H
+
+#include "../driver/gpio.h"
+
+struct gpio_dev_t
+{
+};
+inline gpio_dev_t GPIO;
+
+inline int gpio_ll_get_level(gpio_dev_t *, gpio_num_t) { return 1; }
+inline void gpio_ll_set_intr_type(gpio_dev_t *, gpio_num_t, gpio_int_type_t) {}
+
+#endif
@@ -0,0 +1,52 @@
+#include "alloc_trace.h"
+
+#ifdef UI_ALLOC_TRACE
+
+#include <atomic>
+
+// Linked with -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc so every
+// allocation in the image, including Arduino String, passes through here
+extern "C" void *__real_malloc(size_t size);
+extern "C" void *__real_calloc(size_t count, size_t size);
+extern "C" void *__real_realloc(void *ptr, size_t size);
+
+static TaskHandle_t tracedTask = nullptr;
+static std::atomic<uint32_t> tracedAllocations(0);
+
+static inline void countAllocation()
+{
+  if (tracedTask != nullptr && xTaskGetCurrentTaskHandle() == tracedTask)
+  {
+    tracedAllocations.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+extern "C" void *__wrap_malloc(size_t size)
+{
+  countAllocation();
+  return __real_malloc(size);
+}
+
+extern "C" void *__wrap_calloc(size_t count, size_t size)
+{
+  countAllocation();
+  return __real_calloc(count, size);
+}
+
+extern "C" void *__wrap_realloc(void *ptr, size_t size)
+{
+  countAllocation();
+  return __real_realloc(ptr, size);
+}
+
+void allocTraceBegin()
+{
+  tracedTask = xTaskGetCurrentTaskHandle();
+}
+
+uint32_t allocTraceCount()
+{
+  return tracedAllocations.load(std::memory_order_relaxed);
+}
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef ALLOC_TRACE_H
+#define ALLOC_TRACE_H
+
+#include <Arduino.h>
+#include "logger.h"
+
+// Counts heap allocations made by the UI task so the render path can be
+// checked for steady-state allocations. Enabled by building with
+// -DUI_ALLOC_TRACE plus the malloc wrap flags listed in platformio.ini;
+// otherwise every call compiles to nothing.
+#ifdef UI_ALLOC_TRACE
+
+// Starts counting allocations made by the calling task
+void allocTraceBegin();
+uint32_t allocTraceCount();
+
+inline void allocTraceReport(const char *where, uint32_t allocations)
+{
+  if (allocations > 0)
+  {
+    LOG_INFO("%s made %u heap allocations", where, (unsigned)allocations);
+  }
+}
+
+#else
+
+inline void allocTraceBegin() {}
+inline uint32_t allocTraceCount() { return 0; }
+inline void allocTraceReport(const char *, uint32_t) {}
+
+#endif
+
+#endif
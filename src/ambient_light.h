@@ -0,0 +1,165 @@
+#ifndef AMBIENT_LIGHT_H
+#define AMBIENT_LIGHT_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <driver/adc.h>
+#include "logger.h"
+
+#define AMBIENT_SAMPLE_MS 1000
+#define AMBIENT_SMOOTHING_SHIFT 3 // Each sample moves the average an eighth of the way
+// 12-bit counts with the photoresistor on the 3V3 side of its divider, so
+// brighter reads higher. The gap between the two is the hysteresis.
+#define AMBIENT_DARK_BELOW 300
+#define AMBIENT_LIGHT_ABOVE 600
+#define AMBIENT_DARK_HOLD_MS 30000 // So a passing shadow does not switch the backlight off
+#define AMBIENT_TASK_CORE 1
+#define AMBIENT_TASK_PRIORITY 1
+#define AMBIENT_TASK_STACK_SIZE 2048
+
+// Samples the photoresistor once a second on its own task and reports when
+// the room goes dark or lit again. Readings are smoothed with an exponential
+// moving average; going dark needs the average to stay below
+// AMBIENT_DARK_BELOW for AMBIENT_DARK_HOLD_MS, while coming back above
+// AMBIENT_LIGHT_ABOVE counts at once, so turning the lights on wakes the
+// display within a sample or two.
+//
+// The sensor has to be on an ADC1 pin (GPIO 32-39). ADC2 belongs to the
+// Wi-Fi driver whenever it is started, which here is always, so begin()
+// refuses ADC2 pins rather than run a task whose reads could never succeed.
+class AmbientLight
+{
+private:
+  adc1_channel_t channel;
+  uint32_t average; // Scaled up by AMBIENT_SMOOTHING_SHIFT bits
+  bool haveAverage;
+  uint32_t belowSinceMs;
+  bool belowThreshold;
+  std::atomic<bool> dark;
+  std::atomic<uint16_t> level;
+  bool reportedDark;
+  TaskHandle_t notifyTask;
+
+  bool findChannel(uint8_t pin)
+  {
+    gpio_num_t io;
+    for (int candidate = 0; candidate < ADC1_CHANNEL_MAX; candidate++)
+    {
+      if (adc1_pad_get_io_num((adc1_channel_t)candidate, &io) == ESP_OK && io == pin)
+      {
+        channel = (adc1_channel_t)candidate;
+        adc1_config_width(ADC_WIDTH_BIT_12);
+        adc1_config_channel_atten(channel, ADC_ATTEN_DB_11);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void setDark(bool isDark)
+  {
+    if (dark.exchange(isDark) != isDark && notifyTask != nullptr)
+    {
+      xTaskNotifyGive(notifyTask);
+    }
+  }
+
+  void sample(uint32_t nowMs)
+  {
+    int raw = adc1_get_raw(channel);
+    if (raw < 0)
+    {
+      return;
+    }
+    uint16_t value = (uint16_t)raw;
+
+    if (!haveAverage)
+    {
+      average = (uint32_t)value << AMBIENT_SMOOTHING_SHIFT;
+      haveAverage = true;
+    }
+    else
+    {
+      average = average - (average >> AMBIENT_SMOOTHING_SHIFT) + value;
+    }
+    uint16_t smoothed = average >> AMBIENT_SMOOTHING_SHIFT;
+    level.store(smoothed);
+
+    if (smoothed > AMBIENT_LIGHT_ABOVE)
+    {
+      belowThreshold = false;
+      setDark(false);
+    }
+    else if (smoothed < AMBIENT_DARK_BELOW)
+    {
+      if (!belowThreshold)
+      {
+        belowThreshold = true;
+        belowSinceMs = nowMs;
+      }
+      if (nowMs - belowSinceMs >= AMBIENT_DARK_HOLD_MS)
+      {
+        setDark(true);
+      }
+    }
+    else
+    {
+      // Between the thresholds the state holds, but a dark spell has to start over
+      belowThreshold = false;
+    }
+  }
+
+  static void run(void *arg)
+  {
+    AmbientLight *self = static_cast<AmbientLight *>(arg);
+    TickType_t lastWake = xTaskGetTickCount();
+    for (;;)
+    {
+      self->sample(millis());
+      vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(AMBIENT_SAMPLE_MS));
+    }
+  }
+
+public:
+  AmbientLight()
+      : channel(ADC1_CHANNEL_0), average(0), haveAverage(false), belowSinceMs(0), belowThreshold(false), dark(false), level(0), reportedDark(false), notifyTask(nullptr) {}
+
+  // Wakes the calling task whenever the room goes dark or lit
+  bool begin(uint8_t pin)
+  {
+    if (!findChannel(pin))
+    {
+      LOG_ERROR("GPIO %u is not an ADC1 pin, ambient light disabled", (unsigned)pin);
+      return false;
+    }
+    notifyTask = xTaskGetCurrentTaskHandle();
+    return xTaskCreatePinnedToCore(run, "ambient", AMBIENT_TASK_STACK_SIZE, this, AMBIENT_TASK_PRIORITY,
+                                   nullptr, AMBIENT_TASK_CORE) == pdPASS;
+  }
+
+  bool isDark() const
+  {
+    return dark.load();
+  }
+
+  // Smoothed reading, 0 until the first sample
+  uint16_t getLevel() const
+  {
+    return level.load();
+  }
+
+  // Reports each change once, like WifiManager::takeChange()
+  bool takeChange(bool &isDark)
+  {
+    bool nowDark = dark.load();
+    if (nowDark == reportedDark)
+    {
+      return false;
+    }
+    reportedDark = nowDark;
+    isDark = nowDark;
+    return true;
+  }
+};
+
+#endif
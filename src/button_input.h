@@ -0,0 +1,224 @@
+#ifndef BUTTON_INPUT_H
+#define BUTTON_INPUT_H
+
+#include <Arduino.h>
+#include <algorithm>
+#include <atomic>
+#include <driver/gpio.h>
+#include <esp_sleep.h>
+#include <hal/gpio_ll.h>
+
+#define BUTTON_COUNT 3
+#define BUTTON_EDGE_QUEUE_SIZE 32 // Power of two
+#define BUTTON_HOLD_MS 800
+
+enum ButtonId : uint8_t
+{
+  BUTTON_UP,
+  BUTTON_DOWN,
+  BUTTON_ACTION,
+  BUTTON_ACTION_HOLD // The action button released after BUTTON_HOLD_MS or more
+};
+
+// Interrupt-driven buttons. The GPIO ISR only timestamps each edge into a
+// lock-free single-producer/single-consumer ring and wakes the UI task. The
+// UI task drains the ring and treats a button as settled once no edge has
+// arrived for the debounce window, so presses are never lost to a busy loop
+// and no time is spent in delay().
+//
+// Edge interrupts cannot wake the chip from light sleep, so each pin uses a
+// level interrupt that the ISR flips to the opposite level after every
+// transition. That behaves like CHANGE while doubling as a GPIO wake source.
+//
+// Up and down report as soon as they settle pressed. The action button
+// reports on release instead, as a press or a hold depending on how long it
+// was down, so a hold never also counts as a press.
+class ButtonInput
+{
+private:
+  struct Edge
+  {
+    uint8_t button;
+    uint8_t level;
+    uint32_t timeMs;
+  };
+
+  struct Button
+  {
+    ButtonInput *owner;
+    uint8_t id;
+    uint8_t pin;
+    uint8_t rawLevel;
+    uint8_t stableLevel;
+    uint32_t lastEdgeMs;
+    uint32_t pressedMs; // When the last press began
+    bool settling;
+  };
+
+  Button buttons[BUTTON_COUNT];
+  Edge edges[BUTTON_EDGE_QUEUE_SIZE];
+  std::atomic<uint8_t> edgeHead; // Advanced by the ISR
+  std::atomic<uint8_t> edgeTail; // Advanced by the UI task
+  std::atomic<bool> overflowed;
+  uint32_t debounceMs;
+  TaskHandle_t notifyTask;
+
+  static gpio_int_type_t levelChangeFrom(uint8_t level)
+  {
+    return level == HIGH ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL;
+  }
+
+  static void IRAM_ATTR onEdge(void *arg)
+  {
+    Button *button = static_cast<Button *>(arg);
+    gpio_num_t pin = static_cast<gpio_num_t>(button->pin);
+    uint8_t level = gpio_ll_get_level(&GPIO, pin);
+    gpio_ll_set_intr_type(&GPIO, pin, levelChangeFrom(level));
+    button->owner->pushEdge(button->id, level, millis());
+  }
+
+  void IRAM_ATTR pushEdge(uint8_t id, uint8_t level, uint32_t timeMs)
+  {
+    uint8_t head = edgeHead.load(std::memory_order_relaxed);
+    uint8_t next = (head + 1) & (BUTTON_EDGE_QUEUE_SIZE - 1);
+    if (next == edgeTail.load(std::memory_order_acquire))
+    {
+      // The UI resamples every pin instead of trusting a gapped edge history
+      overflowed.store(true, std::memory_order_relaxed);
+    }
+    else
+    {
+      edges[head] = {id, level, timeMs};
+      edgeHead.store(next, std::memory_order_release);
+    }
+
+    if (notifyTask != nullptr)
+    {
+      BaseType_t woken = pdFALSE;
+      vTaskNotifyGiveFromISR(notifyTask, &woken);
+      if (woken == pdTRUE)
+      {
+        portYIELD_FROM_ISR();
+      }
+    }
+  }
+
+  void drainEdges(uint32_t nowMs)
+  {
+    uint8_t tail = edgeTail.load(std::memory_order_relaxed);
+    uint8_t head = edgeHead.load(std::memory_order_acquire);
+    while (tail != head)
+    {
+      const Edge &edge = edges[tail];
+      Button &button = buttons[edge.button];
+      button.rawLevel = edge.level;
+      button.lastEdgeMs = edge.timeMs;
+      button.settling = true;
+      tail = (tail + 1) & (BUTTON_EDGE_QUEUE_SIZE - 1);
+    }
+    edgeTail.store(tail, std::memory_order_release);
+
+    if (overflowed.exchange(false, std::memory_order_relaxed))
+    {
+      for (Button &button : buttons)
+      {
+        button.rawLevel = digitalRead(button.pin);
+        button.lastEdgeMs = nowMs;
+        button.settling = true;
+      }
+    }
+  }
+
+public:
+  ButtonInput(uint32_t debounce)
+      : edgeHead(0), edgeTail(0), overflowed(false), debounceMs(debounce), notifyTask(nullptr) {}
+
+  // Wakes the calling task through its notification value on every edge,
+  // including from automatic light sleep
+  void begin(uint8_t upPin, uint8_t downPin, uint8_t actionPin)
+  {
+    const uint8_t pins[BUTTON_COUNT] = {upPin, downPin, actionPin};
+    notifyTask = xTaskGetCurrentTaskHandle();
+
+    // Already installed is fine; the service is shared with attachInterrupt()
+    gpio_install_isr_service(0);
+
+    for (uint8_t i = 0; i < BUTTON_COUNT; i++)
+    {
+      Button &button = buttons[i];
+      pinMode(pins[i], INPUT_PULLUP);
+      button.owner = this;
+      button.id = i;
+      button.pin = pins[i];
+      button.rawLevel = digitalRead(pins[i]);
+      button.stableLevel = button.rawLevel;
+      button.lastEdgeMs = 0;
+      button.pressedMs = 0;
+      button.settling = false;
+
+      gpio_num_t pin = static_cast<gpio_num_t>(pins[i]);
+      gpio_isr_handler_add(pin, onEdge, &button);
+      gpio_wakeup_enable(pin, levelChangeFrom(button.rawLevel));
+      gpio_intr_enable(pin);
+    }
+    esp_sleep_enable_gpio_wakeup();
+  }
+
+  // Returns one debounced press per call; call until it returns false
+  bool nextPress(ButtonId &pressed)
+  {
+    // Sample the clock after draining so no edge is newer than nowMs
+    drainEdges(millis());
+    uint32_t nowMs = millis();
+
+    for (Button &button : buttons)
+    {
+      if (!button.settling || nowMs - button.lastEdgeMs < debounceMs)
+      {
+        continue;
+      }
+
+      button.settling = false;
+      if (button.rawLevel == button.stableLevel)
+      {
+        continue;
+      }
+
+      button.stableLevel = button.rawLevel;
+      if (button.id == BUTTON_ACTION)
+      {
+        if (button.stableLevel == LOW)
+        {
+          button.pressedMs = button.lastEdgeMs;
+          continue;
+        }
+        pressed = button.lastEdgeMs - button.pressedMs >= BUTTON_HOLD_MS ? BUTTON_ACTION_HOLD : BUTTON_ACTION;
+        return true;
+      }
+      if (button.stableLevel == LOW)
+      {
+        pressed = static_cast<ButtonId>(button.id);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Milliseconds until a bouncing button settles, or UINT32_MAX if none is pending
+  uint32_t msUntilSettled() const
+  {
+    uint32_t nowMs = millis();
+    uint32_t wait = UINT32_MAX;
+    for (const Button &button : buttons)
+    {
+      if (button.settling)
+      {
+        uint32_t elapsed = nowMs - button.lastEdgeMs;
+        wait = std::min<uint32_t>(wait, elapsed >= debounceMs ? 0 : debounceMs - elapsed);
+      }
+    }
+    return wait;
+  }
+};
+
+#endif
@@ -0,0 +1,237 @@
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <esp_sntp.h>
+#include <esp_timer.h>
+#include <sys/time.h>
+#include <time.h>
+#include "logger.h"
+
+#define CLOCK_STORE_NAMESPACE "clock"
+// Anything earlier is the RTC counting up from zero after a power loss
+#define CLOCK_VALID_EPOCH 1704067200 // 2024-01-01T00:00:00Z
+#define CLOCK_SAVE_INTERVAL_MS (60 * 60 * 1000)
+
+enum ClockState : uint8_t
+{
+  CLOCK_UNKNOWN,     // No idea what time it is; nothing to count from yet
+  CLOCK_PROVISIONAL, // Seeded from the last saved epoch, behind by however long power was off
+  CLOCK_SYNCED       // Set by SNTP, or kept by the RTC across a reset
+};
+
+// Brings the wall clock up without blocking boot. The system time survives
+// software resets and deep sleep in the RTC, so it is often already right;
+// after a power loss it is seeded from the epoch last saved to NVS, or from
+// the newest restored timer value if that is later, and marked provisional.
+// Restored values were stamped on a synced clock, so the seed goes just past
+// them and a sync only shifts what was stamped after it. SNTP runs in the background and its callback, on the lwIP
+// task, records how far each sync moved the clock so the UI task can shift
+// timestamps it took on the old clock.
+class ClockSync
+{
+private:
+  Preferences prefs;
+  bool opened;
+  ClockState state;
+  unsigned long lastSaveMs;
+  TaskHandle_t notifyTask;
+
+  // Shared with the SNTP callback
+  portMUX_TYPE lock;
+  time_t anchorEpoch;     // Clock reading at the last seed or sync
+  int64_t anchorUptimeUs; // esp_timer value at the same moment
+  bool syncPending;
+  time_t pendingSince;
+  int32_t pendingCorrection;
+
+  static ClockSync *&instance()
+  {
+    static ClockSync *active = nullptr;
+    return active;
+  }
+
+  static void onSync(struct timeval *tv)
+  {
+    ClockSync *clock = instance();
+    if (clock != nullptr)
+    {
+      clock->recordSync(tv->tv_sec);
+    }
+  }
+
+  void recordSync(time_t syncedEpoch)
+  {
+    int64_t uptimeUs = esp_timer_get_time();
+
+    portENTER_CRITICAL(&lock);
+    time_t expected = anchorEpoch + (time_t)((uptimeUs - anchorUptimeUs) / 1000000);
+    if (!syncPending)
+    {
+      pendingSince = anchorEpoch;
+      pendingCorrection = 0;
+    }
+    pendingCorrection += (int32_t)(syncedEpoch - expected);
+    syncPending = true;
+    anchorEpoch = syncedEpoch;
+    anchorUptimeUs = uptimeUs;
+    portEXIT_CRITICAL(&lock);
+
+    if (notifyTask != nullptr)
+    {
+      xTaskNotifyGive(notifyTask);
+    }
+  }
+
+  void save(time_t now)
+  {
+    if (opened)
+    {
+      prefs.putLong64("epoch", now);
+    }
+  }
+
+public:
+  ClockSync()
+      : opened(false), state(CLOCK_UNKNOWN), lastSaveMs(0), notifyTask(nullptr),
+        anchorEpoch(0), anchorUptimeUs(0), syncPending(false), pendingSince(0), pendingCorrection(0)
+  {
+    portMUX_INITIALIZE(&lock);
+  }
+
+  // Returns at once; syncs wake the calling task through its notification value
+  void begin(long gmtOffsetSec, int daylightOffsetSec, const char *server)
+  {
+    notifyTask = xTaskGetCurrentTaskHandle();
+    opened = prefs.begin(CLOCK_STORE_NAMESPACE, false);
+
+    time_t now = time(nullptr);
+    if (now >= CLOCK_VALID_EPOCH)
+    {
+      state = CLOCK_SYNCED;
+      LOG_INFO("Clock kept across reset");
+    }
+    else
+    {
+      int64_t saved = opened ? prefs.getLong64("epoch", 0) : 0;
+      if (saved >= CLOCK_VALID_EPOCH)
+      {
+        struct timeval tv = {(time_t)saved, 0};
+        settimeofday(&tv, nullptr);
+        now = (time_t)saved;
+        state = CLOCK_PROVISIONAL;
+        LOG_INFO("Clock seeded from last saved time");
+      }
+      else
+      {
+        LOG_INFO("Clock unknown until SNTP sync");
+      }
+    }
+
+    anchorEpoch = now;
+    anchorUptimeUs = esp_timer_get_time();
+    lastSaveMs = millis();
+
+    instance() = this;
+    sntp_set_time_sync_notification_cb(onSync);
+    configTime(gmtOffsetSec, daylightOffsetSec, server);
+  }
+
+  // After timers are restored, with the newest time among them. A
+  // provisional or unknown clock behind it moves to just after it. Returns
+  // how far the clock moved, so values stamped on it meanwhile can follow.
+  int32_t seedAfter(time_t newest)
+  {
+    if (state == CLOCK_SYNCED || newest < CLOCK_VALID_EPOCH)
+    {
+      return 0;
+    }
+    time_t now = time(nullptr);
+    time_t seed = newest + 1;
+    if (now >= seed)
+    {
+      return 0;
+    }
+
+    portENTER_CRITICAL(&lock);
+    bool synced = syncPending;
+    if (!synced)
+    {
+      anchorEpoch = seed;
+      anchorUptimeUs = esp_timer_get_time();
+    }
+    portEXIT_CRITICAL(&lock);
+    if (synced)
+    {
+      // SNTP got there first and set the real time
+      return 0;
+    }
+
+    struct timeval tv = {seed, 0};
+    settimeofday(&tv, nullptr);
+    state = CLOCK_PROVISIONAL;
+    LOG_INFO("Clock seeded from restored timers");
+    return (int32_t)(seed - now);
+  }
+
+  // Saves the current time as the seed for the next power loss. Called
+  // whenever timer state reaches flash, so the seed is never behind it.
+  void checkpoint()
+  {
+    if (state != CLOCK_UNKNOWN)
+    {
+      lastSaveMs = millis();
+      save(time(nullptr));
+    }
+  }
+
+  // Keeps the saved epoch recent enough to be a useful seed after power loss
+  void update(unsigned long nowMs)
+  {
+    if (state == CLOCK_UNKNOWN || nowMs - lastSaveMs < CLOCK_SAVE_INTERVAL_MS)
+    {
+      return;
+    }
+    lastSaveMs = nowMs;
+    save(time(nullptr));
+  }
+
+  // Reports each sync once. Timestamps at or after since were taken on the
+  // clock that correction seconds of adjustment have just fixed.
+  bool takeSync(time_t &since, int32_t &correction)
+  {
+    portENTER_CRITICAL(&lock);
+    bool pending = syncPending;
+    since = pendingSince;
+    correction = pendingCorrection;
+    syncPending = false;
+    portEXIT_CRITICAL(&lock);
+
+    if (!pending)
+    {
+      return false;
+    }
+
+    if (state != CLOCK_SYNCED)
+    {
+      LOG_INFO("Clock synced, corrected by %ld s", (long)correction);
+    }
+    state = CLOCK_SYNCED;
+    lastSaveMs = millis();
+    save(time(nullptr));
+    return true;
+  }
+
+  ClockState getState() const
+  {
+    return state;
+  }
+
+  bool isSynced() const
+  {
+    return state == CLOCK_SYNCED;
+  }
+};
+
+#endif
@@ -0,0 +1,353 @@
+#ifndef CONNECTION_POOL_H
+#define CONNECTION_POOL_H
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <WiFi.h>
+#include <WiFiClientSecure.h>
+#include <freertos/semphr.h>
+#include "dns_cache.h"
+#include "http_body_stream.h"
+#include "logger.h"
+
+#define CONNECTION_POOL_SIZE 4
+#define CONNECTION_IDLE_TIMEOUT_MS 120000
+#define MAX_HOST_LENGTH 63
+#define HTTPS_PORT 443
+
+// Keep-alive TLS clients shared by every polling timer. The pool size bounds
+// how many mbedTLS contexts can exist no matter how many timers are
+// configured, and idle or server-closed connections are stopped so their
+// buffers go back to the heap. Each network worker leases a client for the
+// length of one request, so two workers polling the same host at once get
+// a connection each; a leased client is never touched by anyone else.
+// Addresses come from the pool's DnsCache.
+class ConnectionPool
+{
+private:
+  struct Slot
+  {
+    char host[MAX_HOST_LENGTH + 1];
+    WiFiClientSecure client;
+    unsigned long lastUsedMs;
+    bool leased;
+  };
+
+  Slot slots[CONNECTION_POOL_SIZE];
+  SemaphoreHandle_t mutex;
+  DnsCache dnsCache;
+
+public:
+  ConnectionPool() : mutex(nullptr)
+  {
+    for (Slot &slot : slots)
+    {
+      slot.host[0] = '\0';
+      slot.lastUsedMs = 0;
+      slot.leased = false;
+      slot.client.setInsecure();
+    }
+  }
+
+  bool begin()
+  {
+    mutex = xSemaphoreCreateMutex();
+    return mutex != nullptr && dnsCache.begin();
+  }
+
+  DnsCache &dns()
+  {
+    return dnsCache;
+  }
+
+  // Leases a client for host, preferring one already connected there and
+  // otherwise taking over the least recently used free slot. Returns nullptr
+  // when every slot is leased.
+  WiFiClientSecure *acquire(const char *host)
+  {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    Slot *match = nullptr;
+    Slot *victim = nullptr;
+    for (Slot &slot : slots)
+    {
+      if (slot.leased)
+      {
+        continue;
+      }
+      if (strcmp(slot.host, host) == 0)
+      {
+        match = &slot;
+        break;
+      }
+      if (victim == nullptr || slot.host[0] == '\0' ||
+          (victim->host[0] != '\0' && slot.lastUsedMs < victim->lastUsedMs))
+      {
+        victim = &slot;
+      }
+    }
+
+    Slot *slot = match != nullptr ? match : victim;
+    if (slot == nullptr)
+    {
+      xSemaphoreGive(mutex);
+      return nullptr;
+    }
+
+    if (slot == victim)
+    {
+      if (victim->host[0] != '\0')
+      {
+        LOG_DEBUG("Evicting pooled connection to %s", victim->host);
+      }
+      victim->client.stop();
+      strncpy(victim->host, host, MAX_HOST_LENGTH);
+      victim->host[MAX_HOST_LENGTH] = '\0';
+    }
+    slot->lastUsedMs = millis();
+    slot->leased = true;
+    xSemaphoreGive(mutex);
+    return &slot->client;
+  }
+
+  // Returns a leased client; one left mid-response is closed rather than reused
+  void release(WiFiClientSecure *client, bool reusable)
+  {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    for (Slot &slot : slots)
+    {
+      if (&slot.client == client)
+      {
+        if (!reusable)
+        {
+          slot.client.stop();
+        }
+        slot.lastUsedMs = millis();
+        slot.leased = false;
+      }
+    }
+    xSemaphoreGive(mutex);
+  }
+
+  // Leased clients are left alone
+  void closeAll()
+  {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    for (Slot &slot : slots)
+    {
+      if (!slot.leased)
+      {
+        slot.client.stop();
+      }
+    }
+    xSemaphoreGive(mutex);
+  }
+
+  // Frees TLS state for connections the server dropped or that sat unused
+  void closeIdle()
+  {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    unsigned long nowMs = millis();
+    for (Slot &slot : slots)
+    {
+      if (slot.host[0] == '\0' || slot.leased)
+      {
+        continue;
+      }
+      if (!slot.client.connected() || nowMs - slot.lastUsedMs >= CONNECTION_IDLE_TIMEOUT_MS)
+      {
+        slot.client.stop();
+      }
+    }
+    xSemaphoreGive(mutex);
+  }
+};
+
+// Copies the host part of an http(s) URL into host
+inline bool hostFromUrl(const char *url, char *host, size_t size)
+{
+  const char *start = strstr(url, "://");
+  start = start ? start + 3 : url;
+  size_t length = strcspn(start, ":/?");
+  if (length == 0 || length >= size)
+  {
+    return false;
+  }
+  memcpy(host, start, length);
+  host[length] = '\0';
+  return true;
+}
+
+// A GET over a pooled connection. The body is exposed as a stream and is
+// drained on end() so the next request to the same host can reuse the socket.
+class PooledRequest
+{
+private:
+  ConnectionPool &pool;
+  HTTPClient http;
+  HttpBodyStream body;
+  WiFiClientSecure *client;
+  char host[MAX_HOST_LENGTH + 1];
+  bool active;
+  bool hasBody;
+  bool connectedFresh;
+  uint32_t dnsUs;
+  uint32_t tlsUs;
+  uint32_t firstByteUs;
+
+  // Opening the connection here rather than inside HTTPClient lets the DNS
+  // lookup and the TLS handshake be timed separately. A cached address that
+  // refuses the connection may have moved, so it is looked up once more. If
+  // it still fails, GET() reports the error through HTTPClient's own attempt.
+  void connect()
+  {
+    uint32_t start = micros();
+    IPAddress ip;
+    bool fromCache;
+    bool resolved = pool.dns().resolve(host, ip, &fromCache);
+    dnsUs = micros() - start;
+    if (!resolved)
+    {
+      return;
+    }
+
+    start = micros();
+    connectedFresh = client->connect(ip, HTTPS_PORT, host, nullptr, nullptr, nullptr) == 1;
+    if (!connectedFresh && fromCache)
+    {
+      pool.dns().invalidate(host);
+      IPAddress fresh;
+      if (pool.dns().resolve(host, fresh) && (uint32_t)fresh != (uint32_t)ip)
+      {
+        connectedFresh = client->connect(fresh, HTTPS_PORT, host, nullptr, nullptr, nullptr) == 1;
+      }
+    }
+    tlsUs = micros() - start;
+  }
+
+public:
+  PooledRequest(ConnectionPool &connectionPool)
+      : pool(connectionPool), client(nullptr), active(false), hasBody(false),
+        connectedFresh(false), dnsUs(0), tlsUs(0), firstByteUs(0)
+  {
+    host[0] = '\0';
+  }
+
+  ~PooledRequest()
+  {
+    end();
+  }
+
+  bool begin(const char *url, uint16_t timeoutMs = 5000)
+  {
+    if (!hostFromUrl(url, host, sizeof(host)))
+    {
+      LOG_ERROR("Bad URL: %s", url);
+      return false;
+    }
+
+    http.setReuse(true);
+    http.setTimeout(timeoutMs);
+    client = pool.acquire(host);
+    if (client == nullptr)
+    {
+      LOG_ERROR("No free connection for %s", host);
+      return false;
+    }
+    if (!http.begin(*client, url))
+    {
+      pool.release(client, false);
+      client = nullptr;
+      return false;
+    }
+
+    static const char *headerKeys[] = {"Transfer-Encoding", "ETag", "Last-Modified", "Retry-After",
+                                       "X-RateLimit-Remaining", "X-RateLimit-Reset",
+                                       "RateLimit-Remaining", "RateLimit-Reset"};
+    http.collectHeaders(headerKeys, sizeof(headerKeys) / sizeof(headerKeys[0]));
+    active = true;
+    return true;
+  }
+
+  void addHeader(const char *name, const char *value)
+  {
+    http.addHeader(name, value);
+  }
+
+  int GET()
+  {
+    connectedFresh = false;
+    if (!client->connected())
+    {
+      connect();
+    }
+
+    uint32_t start = micros();
+    int httpCode = http.GET();
+    firstByteUs = micros() - start;
+    hasBody = httpCode > 0 && httpCode != HTTP_CODE_NO_CONTENT && httpCode != HTTP_CODE_NOT_MODIFIED;
+    if (hasBody)
+    {
+      bool chunked = http.header("Transfer-Encoding").equalsIgnoreCase("chunked");
+      body.begin(*http.getStreamPtr(), chunked, http.getSize());
+    }
+    return httpCode;
+  }
+
+  String header(const char *name)
+  {
+    return http.header(name);
+  }
+
+  Stream &getStream()
+  {
+    return body;
+  }
+
+  // Whether GET() opened a new connection, making dnsMicros() and tlsMicros() meaningful
+  bool openedConnection() const
+  {
+    return connectedFresh;
+  }
+
+  uint32_t dnsMicros() const
+  {
+    return dnsUs;
+  }
+
+  uint32_t tlsMicros() const
+  {
+    return tlsUs;
+  }
+
+  uint32_t firstByteMicros() const
+  {
+    return firstByteUs;
+  }
+
+  uint32_t bodyWaitMicros() const
+  {
+    return body.waitMicros();
+  }
+
+  size_t bodyBytes() const
+  {
+    return body.bytesReceived();
+  }
+
+  void end()
+  {
+    if (!active)
+    {
+      return;
+    }
+
+    bool reusable = !hasBody || body.drain();
+    http.end();
+    pool.release(client, reusable);
+    client = nullptr;
+    active = false;
+    hasBody = false;
+  }
+};
+
+#endif
@@ -0,0 +1,405 @@
+#ifndef DNS_CACHE_H
+#define DNS_CACHE_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <algorithm>
+#include <freertos/semphr.h>
+#include "logger.h"
+
+#define DNS_CACHE_SIZE 8
+#define DNS_HOST_LENGTH 63
+// Answers are kept for their TTL, clamped to this range
+#define DNS_CACHE_MIN_TTL 30
+#define DNS_CACHE_MAX_TTL (60 * 60)
+#define DNS_CACHE_FALLBACK_TTL 60 // For addresses from hostByName(), which hides the TTL
+#define DNS_QUERY_TIMEOUT_MS 1500
+#define DNS_PORT 53
+#define DNS_PACKET_SIZE 512
+#define DNS_QUESTION_SIZE (DNS_HOST_LENGTH + 6) // Encoded name of a cacheable host, type and class
+
+// Addresses of the hosts polling timers talk to, each kept for the TTL its
+// answer carried. hostByName() does not report TTLs, so lookups send their
+// own A query to the resolver Wi-Fi was given and only fall back to
+// hostByName() if that fails. Timers register their hosts with remember(),
+// and prefetch() resolves any that are missing or expired, so after Wi-Fi
+// connects the first polls go straight to the TLS handshake. Safe to use
+// from any task; lookups run one at a time.
+class DnsCache
+{
+private:
+  struct Entry
+  {
+    char host[DNS_HOST_LENGTH + 1];
+    IPAddress ip;
+    bool resolved;
+    unsigned long expiresMs;
+    unsigned long lastUsedMs;
+  };
+
+  Entry entries[DNS_CACHE_SIZE];
+  SemaphoreHandle_t mutex;      // Guards entries
+  SemaphoreHandle_t queryMutex; // hostByName() keeps its result in a global
+
+  static bool fresh(const Entry &entry, unsigned long nowMs)
+  {
+    return entry.resolved && (long)(entry.expiresMs - nowMs) > 0;
+  }
+
+  // Caller holds mutex
+  Entry *find(const char *host)
+  {
+    for (Entry &entry : entries)
+    {
+      if (strcmp(entry.host, host) == 0)
+      {
+        return &entry;
+      }
+    }
+    return nullptr;
+  }
+
+  // Caller holds mutex; reuses the least recently used entry when full
+  Entry *findOrAdd(const char *host)
+  {
+    Entry *entry = find(host);
+    if (entry != nullptr)
+    {
+      return entry;
+    }
+
+    entry = &entries[0];
+    for (Entry &candidate : entries)
+    {
+      if (candidate.host[0] == '\0')
+      {
+        entry = &candidate;
+        break;
+      }
+      if (candidate.lastUsedMs < entry->lastUsedMs)
+      {
+        entry = &candidate;
+      }
+    }
+    strncpy(entry->host, host, DNS_HOST_LENGTH);
+    entry->host[DNS_HOST_LENGTH] = '\0';
+    entry->resolved = false;
+    entry->lastUsedMs = millis();
+    return entry;
+  }
+
+  bool cached(const char *host, IPAddress &ip)
+  {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    Entry *entry = find(host);
+    unsigned long nowMs = millis();
+    bool hit = entry != nullptr && fresh(*entry, nowMs);
+    if (hit)
+    {
+      ip = entry->ip;
+      entry->lastUsedMs = nowMs;
+    }
+    xSemaphoreGive(mutex);
+    return hit;
+  }
+
+  void store(const char *host, const IPAddress &ip, uint32_t ttl)
+  {
+    ttl = std::min<uint32_t>(std::max<uint32_t>(ttl, DNS_CACHE_MIN_TTL), DNS_CACHE_MAX_TTL);
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    Entry *entry = findOrAdd(host);
+    entry->ip = ip;
+    entry->resolved = true;
+    entry->expiresMs = millis() + ttl * 1000;
+    entry->lastUsedMs = millis();
+    xSemaphoreGive(mutex);
+  }
+
+  // Advances offset past a possibly compressed name; false if it runs off the end
+  static bool skipName(const uint8_t *packet, size_t length, size_t &offset)
+  {
+    while (offset < length)
+    {
+      uint8_t label = packet[offset];
+      if ((label & 0xC0) == 0xC0)
+      {
+        offset += 2;
+        return offset <= length;
+      }
+      offset += 1 + label;
+      if (label == 0)
+      {
+        return offset <= length;
+      }
+    }
+    return false;
+  }
+
+  static size_t buildQuery(uint8_t *packet, uint16_t id, const char *host)
+  {
+    const uint8_t header[] = {(uint8_t)(id >> 8), (uint8_t)id, 0x01, 0x00, // Recursion desired
+                              0, 1, 0, 0, 0, 0, 0, 0};                      // One question
+    memcpy(packet, header, sizeof(header));
+    size_t offset = sizeof(header);
+
+    const char *label = host;
+    while (*label != '\0')
+    {
+      size_t length = strcspn(label, ".");
+      if (length == 0 || length > 63 || offset + length + 6 > DNS_PACKET_SIZE)
+      {
+        return 0;
+      }
+      packet[offset++] = (uint8_t)length;
+      memcpy(packet + offset, label, length);
+      offset += length;
+      label += length;
+      label += *label == '.' ? 1 : 0;
+    }
+
+    const uint8_t question[] = {0, 0, 1, 0, 1}; // End of name, type A, class IN
+    memcpy(packet + offset, question, sizeof(question));
+    return offset + sizeof(question);
+  }
+
+  // Names compare case-insensitively, and the length and type bytes are
+  // never ASCII letters, so the whole question can be folded at once
+  static bool sameQuestion(const uint8_t *a, const uint8_t *b, size_t length)
+  {
+    for (size_t i = 0; i < length; i++)
+    {
+      if (tolower(a[i]) != tolower(b[i]))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Takes the first A record, with the smallest TTL along any CNAME chain
+  // before it. The reply has to echo the question that was sent, so a stray
+  // or spoofed packet that only guessed the ID is never cached.
+  static bool parseAnswer(const uint8_t *packet, size_t length, uint16_t id, const uint8_t *question,
+                          size_t questionLength, IPAddress &ip, uint32_t &ttl)
+  {
+    if (length < 12 || packet[0] != (uint8_t)(id >> 8) || packet[1] != (uint8_t)id ||
+        (packet[2] & 0x80) == 0 || (packet[3] & 0x0F) != 0)
+    {
+      return false;
+    }
+    uint16_t questions = (packet[4] << 8) | packet[5];
+    uint16_t answers = (packet[6] << 8) | packet[7];
+
+    size_t offset = 12;
+    if (questions != 1 || offset + questionLength > length ||
+        !sameQuestion(packet + offset, question, questionLength))
+    {
+      return false;
+    }
+    offset += questionLength;
+
+    ttl = UINT32_MAX;
+    for (uint16_t i = 0; i < answers; i++)
+    {
+      if (!skipName(packet, length, offset) || offset + 10 > length)
+      {
+        return false;
+      }
+      const uint8_t *record = packet + offset;
+      uint16_t type = (record[0] << 8) | record[1];
+      uint16_t recordClass = (record[2] << 8) | record[3];
+      uint32_t recordTtl = ((uint32_t)record[4] << 24) | ((uint32_t)record[5] << 16) | (record[6] << 8) | record[7];
+      uint16_t dataLength = (record[8] << 8) | record[9];
+      offset += 10;
+      if (offset + dataLength > length)
+      {
+        return false;
+      }
+
+      ttl = std::min(ttl, recordTtl);
+      if (type == 1 && recordClass == 1 && dataLength == 4)
+      {
+        ip = IPAddress(packet[offset], packet[offset + 1], packet[offset + 2], packet[offset + 3]);
+        return true;
+      }
+      offset += dataLength;
+    }
+    return false;
+  }
+
+  static bool query(const char *host, IPAddress &ip, uint32_t &ttl)
+  {
+    IPAddress server = WiFi.dnsIP();
+    if ((uint32_t)server == 0)
+    {
+      return false;
+    }
+
+    uint8_t packet[DNS_PACKET_SIZE];
+    uint16_t id = (uint16_t)esp_random();
+    size_t length = buildQuery(packet, id, host);
+    if (length == 0 || length - 12 > DNS_QUESTION_SIZE)
+    {
+      return false;
+    }
+    // The reply overwrites packet, so keep the question to check it against
+    uint8_t question[DNS_QUESTION_SIZE];
+    size_t questionLength = length - 12;
+    memcpy(question, packet + 12, questionLength);
+
+    WiFiUDP udp;
+    if (udp.beginPacket(server, DNS_PORT) != 1 || udp.write(packet, length) != length || udp.endPacket() != 1)
+    {
+      udp.stop();
+      return false;
+    }
+
+    bool answered = false;
+    unsigned long startMs = millis();
+    while (!answered && millis() - startMs < DNS_QUERY_TIMEOUT_MS)
+    {
+      if (udp.parsePacket() > 0)
+      {
+        int received = udp.read(packet, sizeof(packet));
+        // Anything else arriving on the port is not ours
+        answered = received > 0 && parseAnswer(packet, received, id, question, questionLength, ip, ttl);
+      }
+      else
+      {
+        delay(10);
+      }
+    }
+    udp.stop();
+    return answered;
+  }
+
+public:
+  DnsCache() : mutex(nullptr), queryMutex(nullptr)
+  {
+    for (Entry &entry : entries)
+    {
+      entry.host[0] = '\0';
+      entry.resolved = false;
+      entry.expiresMs = 0;
+      entry.lastUsedMs = 0;
+    }
+  }
+
+  bool begin()
+  {
+    mutex = xSemaphoreCreateMutex();
+    queryMutex = xSemaphoreCreateMutex();
+    return mutex != nullptr && queryMutex != nullptr;
+  }
+
+  // Adds host to what prefetch() resolves; its address is looked up later
+  void remember(const char *host)
+  {
+    if (strlen(host) > DNS_HOST_LENGTH)
+    {
+      return;
+    }
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    findOrAdd(host);
+    xSemaphoreGive(mutex);
+  }
+
+  // Sets fromCache when no lookup was needed, so a caller whose connect then
+  // fails knows the address may be stale
+  bool resolve(const char *host, IPAddress &ip, bool *fromCache = nullptr)
+  {
+    if (fromCache != nullptr)
+    {
+      *fromCache = false;
+    }
+    if (strlen(host) > DNS_HOST_LENGTH)
+    {
+      return WiFi.hostByName(host, ip) == 1;
+    }
+    if (cached(host, ip))
+    {
+      if (fromCache != nullptr)
+      {
+        *fromCache = true;
+      }
+      return true;
+    }
+
+    xSemaphoreTake(queryMutex, portMAX_DELAY);
+    // Another task may have looked it up while this one waited
+    bool resolved = cached(host, ip);
+    if (!resolved)
+    {
+      uint32_t ttl;
+      if (query(host, ip, ttl))
+      {
+        store(host, ip, ttl);
+        resolved = true;
+      }
+      else if (WiFi.hostByName(host, ip) == 1)
+      {
+        store(host, ip, DNS_CACHE_FALLBACK_TTL);
+        resolved = true;
+      }
+    }
+    xSemaphoreGive(queryMutex);
+
+    if (!resolved)
+    {
+      LOG_WARN("DNS lookup for %s failed", host);
+    }
+    return resolved;
+  }
+
+  // Resolves every remembered host without a fresh address; blocks meanwhile
+  void prefetch()
+  {
+    char hosts[DNS_CACHE_SIZE][DNS_HOST_LENGTH + 1];
+    uint8_t count = 0;
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    unsigned long nowMs = millis();
+    for (const Entry &entry : entries)
+    {
+      if (entry.host[0] != '\0' && !fresh(entry, nowMs))
+      {
+        strcpy(hosts[count++], entry.host);
+      }
+    }
+    xSemaphoreGive(mutex);
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+      IPAddress ip;
+      if (resolve(hosts[i], ip))
+      {
+        LOG_DEBUG("Pre-resolved %s to %s", hosts[i], ip.toString().c_str());
+      }
+    }
+  }
+
+  // After a connect to the cached address fails
+  void invalidate(const char *host)
+  {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    Entry *entry = find(host);
+    if (entry != nullptr)
+    {
+      entry->resolved = false;
+    }
+    xSemaphoreGive(mutex);
+  }
+
+  // Drops every address but keeps the hosts for prefetch()
+  void flush()
+  {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    for (Entry &entry : entries)
+    {
+      entry.resolved = false;
+    }
+    xSemaphoreGive(mutex);
+  }
+};
+
+#endif
@@ -0,0 +1,269 @@
+#ifndef HTTP_BODY_STREAM_H
+#define HTTP_BODY_STREAM_H
+
+#include <Arduino.h>
+#include <algorithm>
+
+// Presents an HTTP/1.1 response body as a plain Stream so ArduinoJson can
+// parse it straight off the socket, stripping chunk framing when present.
+// Reads go through a small buffer to avoid one TLS record lookup per byte.
+class HttpBodyStream : public Stream
+{
+private:
+  static const size_t BUFFER_SIZE = 128;
+
+  Stream *source;
+  bool chunked;
+  int32_t remaining; // Bytes left in the current chunk or body, -1 if unknown
+  bool finished;
+  bool failed;
+  size_t received;
+  uint32_t waitUs; // Time spent inside reads from the socket
+  uint8_t buffer[BUFFER_SIZE];
+  size_t bufferPos;
+  size_t bufferLen;
+
+  size_t readSource(uint8_t *dest, size_t length)
+  {
+    uint32_t start = micros();
+    size_t got = source->readBytes(dest, length);
+    waitUs += micros() - start;
+    return got;
+  }
+
+  int readRaw()
+  {
+    uint8_t c;
+    return readSource(&c, 1) == 1 ? c : -1;
+  }
+
+  // Reads a "<hex-size>[;ext]\r\n" line and the terminating trailer after a zero chunk
+  bool nextChunk()
+  {
+    int32_t size = 0;
+    bool digits = false;
+    bool extension = false;
+    for (;;)
+    {
+      int c = readRaw();
+      if (c < 0)
+      {
+        return false;
+      }
+      if (c == '\n')
+      {
+        break;
+      }
+      if (extension || c == '\r')
+      {
+        continue;
+      }
+      if (c == ';')
+      {
+        extension = true;
+        continue;
+      }
+
+      int value = isDigit(c) ? c - '0' : (isHexadecimalDigit(c) ? (c | 0x20) - 'a' + 10 : -1);
+      if (value < 0)
+      {
+        return false;
+      }
+      size = (size << 4) | value;
+      digits = true;
+    }
+
+    if (!digits)
+    {
+      return false;
+    }
+
+    if (size == 0)
+    {
+      // Skip optional trailer headers up to the blank line
+      int lineLength = 0;
+      for (;;)
+      {
+        int c = readRaw();
+        if (c < 0)
+        {
+          return false;
+        }
+        if (c == '\n')
+        {
+          if (lineLength == 0)
+          {
+            break;
+          }
+          lineLength = 0;
+        }
+        else if (c != '\r')
+        {
+          lineLength++;
+        }
+      }
+      finished = true;
+    }
+
+    remaining = size;
+    return true;
+  }
+
+  bool fill()
+  {
+    if (finished || failed)
+    {
+      return false;
+    }
+
+    if (chunked && remaining == 0)
+    {
+      // CRLF closes every data chunk except before the first
+      if (received > 0 && (readRaw() != '\r' || readRaw() != '\n'))
+      {
+        failed = true;
+        return false;
+      }
+      if (!nextChunk())
+      {
+        failed = true;
+        return false;
+      }
+      if (finished)
+      {
+        return false;
+      }
+    }
+    else if (!chunked && remaining == 0)
+    {
+      finished = true;
+      return false;
+    }
+
+    size_t want = BUFFER_SIZE;
+    if (remaining >= 0 && (size_t)remaining < want)
+    {
+      want = remaining;
+    }
+
+    size_t got = readSource(buffer, want);
+    if (got == 0)
+    {
+      // A body without a length ends when the server closes the connection
+      if (remaining < 0)
+      {
+        finished = true;
+      }
+      else
+      {
+        failed = true;
+      }
+      return false;
+    }
+
+    bufferPos = 0;
+    bufferLen = got;
+    received += got;
+    if (remaining >= 0)
+    {
+      remaining -= got;
+    }
+    return true;
+  }
+
+public:
+  HttpBodyStream()
+      : source(nullptr), chunked(false), remaining(0), finished(true), failed(false),
+        received(0), waitUs(0), bufferPos(0), bufferLen(0) {}
+
+  // contentLength is the Content-Length value, or -1 when absent
+  void begin(Stream &stream, bool isChunked, int32_t contentLength)
+  {
+    source = &stream;
+    chunked = isChunked;
+    remaining = isChunked ? 0 : contentLength;
+    finished = !isChunked && contentLength == 0;
+    failed = false;
+    received = 0;
+    waitUs = 0;
+    bufferPos = 0;
+    bufferLen = 0;
+  }
+
+  int available() override
+  {
+    if (bufferPos < bufferLen)
+    {
+      return bufferLen - bufferPos;
+    }
+    return fill() ? bufferLen : 0;
+  }
+
+  int read() override
+  {
+    if (bufferPos >= bufferLen && !fill())
+    {
+      return -1;
+    }
+    return buffer[bufferPos++];
+  }
+
+  int peek() override
+  {
+    if (bufferPos >= bufferLen && !fill())
+    {
+      return -1;
+    }
+    return buffer[bufferPos];
+  }
+
+  using Stream::readBytes;
+
+  size_t readBytes(char *dest, size_t length) override
+  {
+    size_t copied = 0;
+    while (copied < length)
+    {
+      if (bufferPos >= bufferLen && !fill())
+      {
+        break;
+      }
+      size_t n = std::min(length - copied, bufferLen - bufferPos);
+      memcpy(dest + copied, buffer + bufferPos, n);
+      bufferPos += n;
+      copied += n;
+    }
+    return copied;
+  }
+
+  size_t write(uint8_t) override
+  {
+    return 0;
+  }
+
+  // Consumes whatever the parser left unread. Returns true when the body
+  // ended cleanly and the connection can carry another request.
+  bool drain()
+  {
+    bufferPos = bufferLen;
+    while (fill())
+    {
+      bufferPos = bufferLen;
+    }
+    return finished && !failed && remaining >= 0;
+  }
+
+  // Raw body bytes received so far, excluding chunk framing
+  size_t bytesReceived() const
+  {
+    return received;
+  }
+
+  // Includes decoding TLS records, which happens inside the socket reads
+  uint32_t waitMicros() const
+  {
+    return waitUs;
+  }
+};
+
+#endif
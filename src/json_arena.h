@@ -0,0 +1,158 @@
+#ifndef JSON_ARENA_H
+#define JSON_ARENA_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <esp_heap_caps.h>
+#include "logger.h"
+
+#define JSON_ARENA_PSRAM_SIZE (64 * 1024)
+#define JSON_ARENA_INTERNAL_SIZE (16 * 1024) // Used when the board has no PSRAM
+
+// Bump allocator over a single block claimed once at startup, in PSRAM when
+// available. Every JsonDocument built during a poll draws from it and the
+// whole arena is reset when the poll finishes, so parsing never touches the
+// general heap and cannot fragment it over weeks of uptime. Not thread-safe:
+// each task that parses JSON owns its own arena.
+class JsonArena : public ArduinoJson::Allocator
+{
+private:
+  // Each block is prefixed with its size so reallocate() can copy it
+  struct Header
+  {
+    uint32_t size;
+    uint32_t reserved; // Keeps payloads 8-byte aligned
+  };
+
+  static const size_t NO_BLOCK = SIZE_MAX;
+
+  uint8_t *base;
+  size_t capacity;
+  size_t used;
+  size_t lastBlock; // Offset of the most recent block, which can grow or pop in place
+  size_t highWater;
+  uint32_t failures;
+
+  static size_t align(size_t size)
+  {
+    return (size + 7) & ~(size_t)7;
+  }
+
+  Header *headerOf(void *ptr) const
+  {
+    return static_cast<Header *>(ptr) - 1;
+  }
+
+  size_t offsetOf(void *ptr) const
+  {
+    return reinterpret_cast<uint8_t *>(headerOf(ptr)) - base;
+  }
+
+public:
+  JsonArena()
+      : base(nullptr), capacity(0), used(0), lastBlock(NO_BLOCK), highWater(0), failures(0) {}
+
+  bool begin()
+  {
+    base = static_cast<uint8_t *>(heap_caps_malloc(JSON_ARENA_PSRAM_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+    capacity = JSON_ARENA_PSRAM_SIZE;
+    if (base == nullptr)
+    {
+      base = static_cast<uint8_t *>(heap_caps_malloc(JSON_ARENA_INTERNAL_SIZE, MALLOC_CAP_8BIT));
+      capacity = JSON_ARENA_INTERNAL_SIZE;
+    }
+
+    if (base == nullptr)
+    {
+      LOG_ERROR("Failed to allocate JSON arena");
+      capacity = 0;
+      return false;
+    }
+
+    LOG_INFO("JSON arena: %u bytes %s", (unsigned)capacity,
+             capacity == JSON_ARENA_PSRAM_SIZE ? "in PSRAM" : "in internal RAM");
+    return true;
+  }
+
+  void *allocate(size_t size) override
+  {
+    size_t total = sizeof(Header) + align(size);
+    if (base == nullptr || total > capacity - used)
+    {
+      // ArduinoJson reports NoMemory rather than falling back to malloc
+      failures++;
+      return nullptr;
+    }
+
+    Header *header = reinterpret_cast<Header *>(base + used);
+    header->size = size;
+    lastBlock = used;
+    used += total;
+    highWater = std::max(highWater, used);
+    return header + 1;
+  }
+
+  // Other blocks are reclaimed in bulk by reset()
+  void deallocate(void *ptr) override
+  {
+    if (ptr != nullptr && offsetOf(ptr) == lastBlock)
+    {
+      used = lastBlock;
+      lastBlock = NO_BLOCK;
+    }
+  }
+
+  void *reallocate(void *ptr, size_t newSize) override
+  {
+    if (ptr == nullptr)
+    {
+      return allocate(newSize);
+    }
+
+    Header *header = headerOf(ptr);
+    if (offsetOf(ptr) == lastBlock)
+    {
+      size_t total = sizeof(Header) + align(newSize);
+      if (total > capacity - lastBlock)
+      {
+        failures++;
+        return nullptr;
+      }
+      header->size = newSize;
+      used = lastBlock + total;
+      highWater = std::max(highWater, used);
+      return ptr;
+    }
+
+    void *moved = allocate(newSize);
+    if (moved != nullptr)
+    {
+      memcpy(moved, ptr, std::min<size_t>(header->size, newSize));
+    }
+    return moved;
+  }
+
+  // Call only once every document using the arena has been destroyed
+  void reset()
+  {
+    used = 0;
+    lastBlock = NO_BLOCK;
+  }
+
+  size_t getCapacity() const
+  {
+    return capacity;
+  }
+
+  size_t getHighWater() const
+  {
+    return highWater;
+  }
+
+  uint32_t getFailures() const
+  {
+    return failures;
+  }
+};
+
+#endif
@@ -0,0 +1,154 @@
+#ifndef LCD_FRAMEBUFFER_H
+#define LCD_FRAMEBUFFER_H
+
+#include <Arduino.h>
+#include <LiquidCrystal_I2C.h>
+
+#define LCD_COLS 16
+#define LCD_ROWS 2
+// A cursor move costs one command byte, the same as rewriting one cell, so
+// runs separated by at most this many unchanged cells are sent as one
+#define LCD_MERGE_GAP 1
+
+// Copies UTF-8 text for display. The character ROM has the degree sign at
+// 0xDF, where UTF-8 needs two bytes; other bytes pass through unchanged.
+inline void lcdText(char *dest, size_t size, const char *text)
+{
+  size_t length = 0;
+  for (const char *c = text; *c != '\0' && length + 1 < size; c++)
+  {
+    if ((uint8_t)c[0] == 0xC2 && (uint8_t)c[1] == 0xB0)
+    {
+      dest[length++] = '\xDF';
+      c++;
+    }
+    else
+    {
+      dest[length++] = *c;
+    }
+  }
+  dest[length] = '\0';
+}
+
+// Shadow of the 16x2 character grid. Callers compose the next frame with
+// print()/printRight() and flush() sends only the cells that differ from what
+// the LCD already shows, so a tick that changes one digit costs one or two
+// bytes over I2C and switching timers never needs a flickering clear().
+class LcdFramebuffer
+{
+private:
+  LiquidCrystal_I2C &lcd;
+  char frame[LCD_ROWS][LCD_COLS];
+  char shown[LCD_ROWS][LCD_COLS];
+  int8_t cursorRow; // Where the LCD's auto-incrementing cursor is, -1 if unknown
+  int8_t cursorCol;
+  bool backlightOn; // As setup() leaves it
+
+  void writeRun(uint8_t row, uint8_t start, uint8_t end)
+  {
+    if (cursorRow != row || cursorCol != start)
+    {
+      lcd.setCursor(start, row);
+    }
+    for (uint8_t col = start; col <= end; col++)
+    {
+      lcd.write((uint8_t)frame[row][col]);
+      shown[row][col] = frame[row][col];
+    }
+    cursorRow = row;
+    cursorCol = end + 1;
+  }
+
+public:
+  LcdFramebuffer(LiquidCrystal_I2C &lcdDisplay) : lcd(lcdDisplay), backlightOn(true)
+  {
+    clear();
+    invalidate();
+  }
+
+  // The PCF8574 backpack switches the backlight through one pin, so there is
+  // no dimming. Sent only on a change, as each call is an I2C write.
+  void setBacklight(bool on)
+  {
+    if (on != backlightOn)
+    {
+      backlightOn = on;
+      on ? lcd.backlight() : lcd.noBacklight();
+    }
+  }
+
+  // Forget what the LCD shows so the next flush rewrites every cell
+  void invalidate()
+  {
+    memset(shown, 0, sizeof(shown));
+    cursorRow = -1;
+    cursorCol = -1;
+  }
+
+  void clear()
+  {
+    memset(frame, ' ', sizeof(frame));
+  }
+
+  void clearRow(uint8_t row)
+  {
+    memset(frame[row], ' ', LCD_COLS);
+  }
+
+  // Text running past the last column is cut off
+  void print(uint8_t col, uint8_t row, const char *text)
+  {
+    for (; col < LCD_COLS && *text != '\0'; col++, text++)
+    {
+      frame[row][col] = *text;
+    }
+  }
+
+  void printRight(uint8_t row, const char *text)
+  {
+    size_t length = strlen(text);
+    print(length < LCD_COLS ? LCD_COLS - length : 0, row, text);
+  }
+
+  // Returns the number of bytes sent to the LCD
+  size_t flush()
+  {
+    size_t sent = 0;
+    for (uint8_t row = 0; row < LCD_ROWS; row++)
+    {
+      uint8_t col = 0;
+      while (col < LCD_COLS)
+      {
+        if (frame[row][col] == shown[row][col])
+        {
+          col++;
+          continue;
+        }
+
+        uint8_t start = col;
+        uint8_t end = col;
+        uint8_t gap = 0;
+        for (col++; col < LCD_COLS; col++)
+        {
+          if (frame[row][col] != shown[row][col])
+          {
+            end = col;
+            gap = 0;
+          }
+          else if (++gap > LCD_MERGE_GAP)
+          {
+            break;
+          }
+        }
+
+        bool moved = cursorRow != row || cursorCol != start;
+        writeRun(row, start, end);
+        sent += (moved ? 1 : 0) + (end - start + 1);
+        col = end + 1;
+      }
+    }
+    return sent;
+  }
+};
+
+#endif
@@ -0,0 +1,257 @@
+#ifndef LOCAL_SERVER_H
+#define LOCAL_SERVER_H
+
+#include <Arduino.h>
+#include <esp_http_server.h>
+#include "logger.h"
+
+#define LOCAL_SERVER_PORT 80
+#define LOCAL_SERVER_TASK_CORE 0
+#define LOCAL_SERVER_TASK_PRIORITY 1
+#define LOCAL_SERVER_TASK_STACK_SIZE 6144
+#define LOCAL_SERVER_MAX_ROUTES 8
+#define LOCAL_SERVER_QUERY_SIZE 160
+#define LOCAL_SERVER_RECV_RETRIES 3 // Receive timeouts tolerated while reading a body
+
+// The request a LocalServer handler is answering. Query arguments come back
+// URL-decoded. Reply with send(), or with beginChunked(), any number of
+// sendChunk() calls and endChunked() for a body of unknown length.
+class LocalRequest
+{
+private:
+  httpd_req_t *req;
+  bool replied;
+  bool chunked;
+
+  // httpd_resp_set_status() keeps the pointer, so these have to be literals
+  static const char *statusLine(int code)
+  {
+    static const struct
+    {
+      int code;
+      const char *line;
+    } lines[] = {{200, "200 OK"}, {202, "202 Accepted"}, {204, "204 No Content"},
+                 {400, "400 Bad Request"}, {401, "401 Unauthorized"}, {404, "404 Not Found"},
+                 {413, "413 Payload Too Large"}};
+    for (const auto &entry : lines)
+    {
+      if (entry.code == code)
+      {
+        return entry.line;
+      }
+    }
+    return "500 Internal Server Error";
+  }
+
+  static int hexValue(char c)
+  {
+    const char *digits = "0123456789abcdef";
+    const char *found = c != '\0' ? strchr(digits, tolower((unsigned char)c)) : nullptr;
+    return found != nullptr ? found - digits : -1;
+  }
+
+  // In place; '+' is a space in query strings
+  static void urlDecode(char *text)
+  {
+    char *out = text;
+    for (const char *in = text; *in != '\0'; in++)
+    {
+      int high, low;
+      if (*in == '%' && (high = hexValue(in[1])) >= 0 && (low = hexValue(in[2])) >= 0)
+      {
+        *out++ = (char)(high << 4 | low);
+        in += 2;
+      }
+      else
+      {
+        *out++ = *in == '+' ? ' ' : *in;
+      }
+    }
+    *out = '\0';
+  }
+
+public:
+  LocalRequest(httpd_req_t *request = nullptr) : req(request), replied(false), chunked(false) {}
+
+  // False if the header is missing or does not fit in out
+  bool header(const char *name, char *out, size_t size) const
+  {
+    size_t length = httpd_req_get_hdr_value_len(req, name);
+    return length > 0 && length < size && httpd_req_get_hdr_value_str(req, name, out, size) == ESP_OK;
+  }
+
+  bool hasArg(const char *name) const
+  {
+    char value[LOCAL_SERVER_QUERY_SIZE];
+    return arg(name, value, sizeof(value));
+  }
+
+  bool arg(const char *name, char *out, size_t size) const
+  {
+    char query[LOCAL_SERVER_QUERY_SIZE];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, name, out, size) != ESP_OK)
+    {
+      return false;
+    }
+    urlDecode(out);
+    return true;
+  }
+
+  size_t bodyLength() const
+  {
+    return req->content_len;
+  }
+
+  // Reads the whole body into out, which needs bodyLength() bytes
+  bool readBody(char *out)
+  {
+    size_t received = 0;
+    uint8_t timeouts = 0;
+    while (received < req->content_len)
+    {
+      int length = httpd_req_recv(req, out + received, req->content_len - received);
+      if (length == HTTPD_SOCK_ERR_TIMEOUT && ++timeouts <= LOCAL_SERVER_RECV_RETRIES)
+      {
+        continue;
+      }
+      if (length <= 0)
+      {
+        return false;
+      }
+      received += length;
+    }
+    return true;
+  }
+
+  void send(int code, const char *type = nullptr, const char *body = nullptr)
+  {
+    httpd_resp_set_status(req, statusLine(code));
+    if (type != nullptr)
+    {
+      httpd_resp_set_type(req, type);
+    }
+    httpd_resp_send(req, body, body != nullptr ? HTTPD_RESP_USE_STRLEN : 0);
+    replied = true;
+  }
+
+  void beginChunked(int code, const char *type)
+  {
+    httpd_resp_set_status(req, statusLine(code));
+    httpd_resp_set_type(req, type);
+    chunked = true;
+    replied = true;
+  }
+
+  void sendChunk(const char *data, size_t length)
+  {
+    if (length > 0)
+    {
+      httpd_resp_send_chunk(req, data, length);
+    }
+  }
+
+  void endChunked()
+  {
+    if (chunked)
+    {
+      httpd_resp_send_chunk(req, nullptr, 0);
+      chunked = false;
+    }
+  }
+
+  // Closes off whatever the handler left open
+  void finish()
+  {
+    endChunked();
+    if (!replied)
+    {
+      send(500, "text/plain", "No response\n");
+    }
+  }
+};
+
+// Small HTTP server on the LAN for pushes and diagnostics, on ESP-IDF's
+// esp_http_server. Its task sleeps in select() until a client connects, so
+// an idle server costs no wakeups, and a request is still answered within
+// milliseconds even while a network worker is stuck in a TLS handshake.
+// Register routes with on() before begin(); handlers run one at a time on
+// the server task, not the UI task, and find their request in request().
+class LocalServer
+{
+public:
+  typedef void (*Handler)();
+
+private:
+  struct Route
+  {
+    LocalServer *owner;
+    const char *path;
+    httpd_method_t method;
+    Handler handler;
+  };
+
+  httpd_handle_t handle;
+  Route routes[LOCAL_SERVER_MAX_ROUTES];
+  uint8_t routeCount;
+  LocalRequest current;
+
+  static esp_err_t dispatch(httpd_req_t *req)
+  {
+    Route *route = static_cast<Route *>(req->user_ctx);
+    route->owner->current = LocalRequest(req);
+    route->handler();
+    route->owner->current.finish();
+    return ESP_OK;
+  }
+
+public:
+  LocalServer() : handle(nullptr), routeCount(0) {}
+
+  void on(const char *path, httpd_method_t method, Handler handler)
+  {
+    if (routeCount >= LOCAL_SERVER_MAX_ROUTES)
+    {
+      LOG_ERROR("Too many local server routes, %s dropped", path);
+      return;
+    }
+    routes[routeCount++] = {this, path, method, handler};
+  }
+
+  LocalRequest &request()
+  {
+    return current;
+  }
+
+  // Listening does not need the network up; clients arrive once it is
+  bool begin()
+  {
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = LOCAL_SERVER_PORT;
+    config.core_id = LOCAL_SERVER_TASK_CORE;
+    config.task_priority = LOCAL_SERVER_TASK_PRIORITY;
+    config.stack_size = LOCAL_SERVER_TASK_STACK_SIZE;
+    config.max_uri_handlers = LOCAL_SERVER_MAX_ROUTES;
+    config.lru_purge_enable = true;
+
+    if (httpd_start(&handle, &config) != ESP_OK)
+    {
+      LOG_ERROR("Failed to start local server");
+      handle = nullptr;
+      return false;
+    }
+    for (uint8_t i = 0; i < routeCount; i++)
+    {
+      httpd_uri_t uri = {};
+      uri.uri = routes[i].path;
+      uri.method = routes[i].method;
+      uri.handler = dispatch;
+      uri.user_ctx = &routes[i];
+      httpd_register_uri_handler(handle, &uri);
+    }
+    LOG_INFO("Local server listening on port %d", LOCAL_SERVER_PORT);
+    return true;
+  }
+};
+
+#endif
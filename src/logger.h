@@ -0,0 +1,175 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <Arduino.h>
+#include <algorithm>
+#include <atomic>
+#include <stdarg.h>
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+// Messages above this level compile out, arguments and all; override with
+// -DLOG_LEVEL=LOG_LEVEL_DEBUG when tracing polls
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_QUEUE_SIZE 32 // Power of two
+#define LOG_LINE_SIZE 120 // Longer messages are truncated
+// Below every other task; the ring absorbs bursts until the drain catches up
+#define LOG_TASK_PRIORITY 0
+#define LOG_TASK_STACK_SIZE 3072
+
+// Callers format straight into a slot of a bounded lock-free ring
+// (multi-producer, single-consumer, one sequence number per slot) and a
+// low-priority task writes the lines to Serial, so logging never waits on the
+// UART. When the ring is full the message is dropped and counted instead of
+// blocking. Safe from any task, not from ISRs.
+class Logger
+{
+private:
+  struct Slot
+  {
+    // pos + 1 once written for position pos, pos + LOG_QUEUE_SIZE once drained
+    std::atomic<uint32_t> sequence;
+    uint16_t length;
+    char text[LOG_LINE_SIZE];
+  };
+
+  Slot slots[LOG_QUEUE_SIZE];
+  std::atomic<uint32_t> head; // Next position a producer claims
+  uint32_t tail;              // Next position to drain, owned by the drain task
+  std::atomic<uint32_t> dropped;
+  TaskHandle_t drainTask;
+
+  static void run(void *param)
+  {
+    Logger *log = static_cast<Logger *>(param);
+    for (;;)
+    {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      log->drain();
+    }
+  }
+
+  void drain()
+  {
+    for (;;)
+    {
+      Slot &slot = slots[tail & (LOG_QUEUE_SIZE - 1)];
+      // A producer still formatting holds up the lines behind it until it publishes
+      if (slot.sequence.load(std::memory_order_acquire) != tail + 1)
+      {
+        break;
+      }
+      Serial.write(reinterpret_cast<const uint8_t *>(slot.text), slot.length);
+      slot.sequence.store(tail + LOG_QUEUE_SIZE, std::memory_order_release);
+      tail++;
+    }
+
+    uint32_t lost = dropped.exchange(0, std::memory_order_relaxed);
+    if (lost > 0)
+    {
+      Serial.printf("W (%lu) %u log messages dropped\n", (unsigned long)millis(), (unsigned)lost);
+    }
+  }
+
+public:
+  Logger() : head(0), tail(0), dropped(0), drainTask(nullptr)
+  {
+    for (uint32_t i = 0; i < LOG_QUEUE_SIZE; i++)
+    {
+      slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  // Lines logged before this are kept and written once the task starts
+  bool begin()
+  {
+    if (xTaskCreate(run, "log", LOG_TASK_STACK_SIZE, this, LOG_TASK_PRIORITY, &drainTask) != pdPASS)
+    {
+      drainTask = nullptr;
+      Serial.println("Failed to start log task");
+      return false;
+    }
+    xTaskNotifyGive(drainTask);
+    return true;
+  }
+
+  void vprint(char level, const char *format, va_list args)
+  {
+    uint32_t pos = head.load(std::memory_order_relaxed);
+    Slot *slot;
+    for (;;)
+    {
+      slot = &slots[pos & (LOG_QUEUE_SIZE - 1)];
+      int32_t lag = (int32_t)(slot->sequence.load(std::memory_order_acquire) - pos);
+      if (lag == 0)
+      {
+        if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          break;
+        }
+      }
+      else if (lag < 0)
+      {
+        // Still holds a line the drain task has not written
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      else
+      {
+        pos = head.load(std::memory_order_relaxed);
+      }
+    }
+
+    int prefix = snprintf(slot->text, LOG_LINE_SIZE, "%c (%lu) ", level, (unsigned long)millis());
+    // Keep the last byte for the newline
+    int room = LOG_LINE_SIZE - prefix - 1;
+    int body = vsnprintf(slot->text + prefix, room, format, args);
+    size_t length = prefix + std::max(0, std::min(body, room - 1));
+    slot->text[length++] = '\n';
+    slot->length = length;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+
+    if (drainTask != nullptr)
+    {
+      xTaskNotifyGive(drainTask);
+    }
+  }
+
+  void print(char level, const char *format, ...) __attribute__((format(printf, 3, 4)))
+  {
+    va_list args;
+    va_start(args, format);
+    vprint(level, format, args);
+    va_end(args);
+  }
+};
+
+inline Logger &logger()
+{
+  static Logger instance;
+  return instance;
+}
+
+// Lines get a level letter and uptime prefix and a trailing newline
+#define LOG_AT(level, letter, format, ...)               \
+  do                                                     \
+  {                                                      \
+    if (LOG_LEVEL >= level)                              \
+    {                                                    \
+      logger().print(letter, format, ##__VA_ARGS__);     \
+    }                                                    \
+  } while (0)
+
+#define LOG_ERROR(format, ...) LOG_AT(LOG_LEVEL_ERROR, 'E', format, ##__VA_ARGS__)
+#define LOG_WARN(format, ...) LOG_AT(LOG_LEVEL_WARN, 'W', format, ##__VA_ARGS__)
+#define LOG_INFO(format, ...) LOG_AT(LOG_LEVEL_INFO, 'I', format, ##__VA_ARGS__)
+#define LOG_DEBUG(format, ...) LOG_AT(LOG_LEVEL_DEBUG, 'D', format, ##__VA_ARGS__)
+
+#endif
@@ -5,678 +5,1151 @@
 #include <WiFi.h>
 #include <HTTPClient.h>
 #include <ArduinoJson.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <LittleFS.h>
+#include <esp_pm.h>
+#include <sys/time.h>
 #include "credentials.h"
+#include "connection_pool.h"
+#include "button_input.h"
+#include "timer_store.h"
+#include "json_arena.h"
+#include "alloc_trace.h"
+#include "ambient_light.h"
+#include "lcd_framebuffer.h"
+#include "wifi_manager.h"
+#include "clock_sync.h"
+#include "local_server.h"
+#include "logger.h"
+#include "metrics.h"
+#include "poll_bench.h"
+#include "timers.h"
+#include "timer_display.h"
+#include "timer_pool.h"
+#include "timer_table.h"
 
 #define LCD_SDA 13
 #define LCD_SCL 14
 #define UP_BUTTON 32
 #define DOWN_BUTTON 33
 #define ACTION_BUTTON 15
-#define PHOTORESISTOR 4
+// Must be an ADC1 pin, see AmbientLight. Units wired for the old GPIO 4
+// (ADC2, unreadable while Wi-Fi runs) must move the photoresistor to 34;
+// until then 34 floats and the backlight switches on noise. GPIO 34 has no
+// internal pull-up, so the divider's fixed resistor is required.
+#define PHOTORESISTOR 34
+// The PCF8574 is only rated for 100 kHz, but common backpacks run fine at
+// 400 kHz; drop this back if the display shows garbage
+#define LCD_I2C_CLOCK_HZ 400000
 
 #define BUTTON_DEBOUNCE_DELAY 50
 
+// Automatic light sleep scales the CPU between these when idle
+#define CPU_MAX_FREQ_MHZ 240
+#define CPU_MIN_FREQ_MHZ 80
+
 #define NTP_SERVER "pool.ntp.org"
 #define GMT_OFFSET_SEC 0
 #define DAYLIGHT_OFFSET_SEC 0
-#define WIFI_TIMEOUT_MS 20000
-
-class Timer
+// Smaller SNTP corrections are drift and leave recorded times alone
+#define CLOCK_REANCHOR_THRESHOLD_SEC 2
+
+// Network polling runs on core 0 so the UI loop on core 1 never blocks on TLS
+#define NETWORK_TASK_CORE 0
+#define NETWORK_TASK_PRIORITY 1
+#define NETWORK_TASK_STACK_SIZE 12288
+// Polls that can run at once, each with its own TLS session and JSON arena
+#define NETWORK_WORKERS 2
+
+// Every PollingTimer has at most one poll in flight, so queues of this length never overflow
+#define MAX_POLLING_TIMERS TIMER_POOL_SIZE
+#define POLL_SPACING_MS 2000
+#define NETWORK_IDLE_CHECK_MS 10000
+// While the display sleeps in the dark, polls come this many times less often
+// and the UI loop wakes at most this often unless something happens
+#define ASLEEP_POLL_STRETCH 4
+#define ASLEEP_LOOP_MS 10000
+
+// Button presses are user data and reach flash within the check interval;
+// poll results are only a cache, so they are batched to spare flash wear
+#define TIMER_SAVE_CHECK_MS 30000
+#define TIMER_SAVE_BATCH_MS (15 * 60 * 1000)
+
+// Reported on /metrics so scrapes from different builds can be told apart
+#ifndef FIRMWARE_VERSION
+#define FIRMWARE_VERSION __DATE__ " " __TIME__
+#endif
+
+#ifndef PUSH_TOKEN
+#define PUSH_TOKEN "" // Older credentials.h files predate pushes
+#endif
+// Pushed times this far ahead are clamped to now; further ahead is rejected
+#define PUSH_MAX_CLOCK_SKEW_SEC 60
+
+// Upload data/ with "pio run -t uploadfs", or replace it with POST /config
+#define TIMER_CONFIG_PATH "/timers.json"
+#define TIMER_CONFIG_MAX_SIZE 8192
+
+// Used when the filesystem has no valid config
+static const char DEFAULT_TIMER_CONFIG[] = R"json({"timers": [
+  {"type": "button", "name": "Last drank water"},
+  {"type": "github", "name": "Last GitHub push", "user": "evjrob", "interval": 300},
+  {"type": "bluesky", "name": "Last Bsky post", "handle": "evjrob.bsky.social", "interval": 300},
+  {"type": "weather", "name": "Last above 0°C", "lat": 49.8954, "lon": -97.1385, "interval": 900}
+]})json";
+
+// Shared keep-alive connections, leased by the network workers
+ConnectionPool connectionPool;
+
+struct PollResult
 {
-protected:
-  const char *name;
-  time_t lastTriggerTime;
-
-public:
-  Timer(const char *displayName,
-        time_t initialTime = time(nullptr))
-      : name(displayName), lastTriggerTime(initialTime) {}
+  PollingTimer *timer;
+  bool success;
+};
 
-  virtual int32_t timeSince(time_t currentTime) const
+// Runs PollingTimer::poll() on core 0 so HTTP and TLS never stall the UI task.
+// NETWORK_WORKERS tasks take requests from one queue, so a slow handshake to
+// one provider does not hold up the others. Trigger times reach the UI
+// through the timers' atomics; completions are reported on a result queue so
+// the scheduler can plan the next poll.
+class NetworkTask
+{
+private:
+  enum Job
   {
-    return difftime(currentTime, lastTriggerTime);
-  }
+    JOB_POLL,
+    JOB_PREFETCH, // Resolve the timers' hosts ahead of their polls
+    JOB_BENCH
+  };
 
-  virtual void trigger(time_t triggerTime)
+  struct Request
   {
-    lastTriggerTime = triggerTime;
-  }
+    Job job;
+    PollingTimer *timer; // For JOB_POLL
+  };
 
-  time_t getLastTriggerTime() const
+  struct Worker
   {
-    return lastTriggerTime;
-  }
-
-  const char *getDisplayName() const
+    NetworkTask *owner;
+    TaskHandle_t handle;
+    JsonArena arena;
+  };
+
+  QueueHandle_t requests;
+  QueueHandle_t results;
+  TaskHandle_t notifyTask;
+  Worker workers[NETWORK_WORKERS];
+  Timer **benchTimers;
+  uint8_t benchCount;
+  std::atomic<bool> benchRunning;
+
+  static void run(void *param)
   {
-    return name;
+    Worker *worker = static_cast<Worker *>(param);
+    worker->owner->loop(worker->arena);
   }
 
-  virtual bool handleButtonPress(time_t currentTime) = 0;
+  void loop(JsonArena &arena)
+  {
+    arena.begin();
 
-  // Add a virtual method to check if timer is pollable
-  virtual bool isPollable() const { return false; }
-  virtual bool checkPoll(time_t currentTime) { return false; }
-};
+    Request request;
+    for (;;)
+    {
+      if (xQueueReceive(requests, &request, pdMS_TO_TICKS(NETWORK_IDLE_CHECK_MS)) != pdTRUE)
+      {
+        connectionPool.closeIdle();
+        continue;
+      }
 
-class ButtonTimer : public Timer
-{
-public:
-  ButtonTimer(const char *displayName,
-              time_t initialTime = time(nullptr))
-      : Timer(displayName, initialTime) {}
+      // Nothing is reported back for these
+      if (request.job == JOB_PREFETCH)
+      {
+        connectionPool.dns().prefetch();
+        continue;
+      }
+      if (request.job == JOB_BENCH)
+      {
+#ifdef POLL_BENCH
+        PollBench::run(benchTimers, benchCount, arena, POLL_BENCH);
+#endif
+        benchRunning.store(false);
+        xTaskNotifyGive(notifyTask);
+        continue;
+      }
 
-  bool handleButtonPress(time_t currentTime) override
-  {
-    trigger(currentTime);
-    return true;
+      PollingTimer *timer = request.timer;
+
+      PollResult result = {timer, timer->poll(arena)};
+      arena.reset();
+      LOG_INFO("Poll %s: %s (arena high water %u)", timer->getDisplayName(),
+               result.success ? "ok" : "failed", (unsigned)arena.getHighWater());
+      // Queued before the poll is released, so a timer never looks idle while
+      // its result is still on the way; reloadTimers() relies on that
+      xQueueSend(results, &result, 0);
+      xTaskNotifyGive(notifyTask);
+      timer->endPoll();
+    }
   }
-};
-
-class PollingTimer : public Timer
-{
-private:
-  time_t lastPollTime;
-  uint32_t pollingInterval;
 
 public:
-  PollingTimer(const char *displayName,
-               uint32_t interval,
-               time_t initialTime = time(nullptr))
-      : Timer(displayName, initialTime),
-        pollingInterval(interval),
-        lastPollTime(initialTime) {}
-
-  bool shouldPoll(time_t currentTime) const
+  NetworkTask()
+      : requests(nullptr), results(nullptr), notifyTask(nullptr), benchTimers(nullptr), benchCount(0),
+        benchRunning(false)
   {
-    return difftime(currentTime, lastPollTime) >= pollingInterval;
+    for (Worker &worker : workers)
+    {
+      worker.owner = this;
+      worker.handle = nullptr;
+    }
   }
 
-  bool handleButtonPress(time_t currentTime) override
+  // Completed polls wake the calling task through its notification value
+  bool begin()
   {
-    if (poll())
+    notifyTask = xTaskGetCurrentTaskHandle();
+    // Room for a prefetch and a bench run besides every timer's poll
+    requests = xQueueCreate(MAX_POLLING_TIMERS + 2, sizeof(Request));
+    results = xQueueCreate(MAX_POLLING_TIMERS, sizeof(PollResult));
+    if (requests == nullptr || results == nullptr)
     {
-      return true;
+      LOG_ERROR("Failed to create network queues");
+      return false;
     }
-    return false;
+
+    // Fewer workers only means less overlap, so any that start are enough
+    uint8_t started = 0;
+    for (uint8_t i = 0; i < NETWORK_WORKERS; i++)
+    {
+      char name[16];
+      snprintf(name, sizeof(name), "network%u", (unsigned)i);
+      if (xTaskCreatePinnedToCore(run, name, NETWORK_TASK_STACK_SIZE, &workers[i], NETWORK_TASK_PRIORITY,
+                                  &workers[i].handle, NETWORK_TASK_CORE) == pdPASS)
+      {
+        started++;
+      }
+    }
+    if (started < NETWORK_WORKERS)
+    {
+      LOG_WARN("Started %u of %d network workers", (unsigned)started, NETWORK_WORKERS);
+    }
+    if (started == 0)
+    {
+      LOG_ERROR("Failed to start network task");
+      vQueueDelete(requests);
+      vQueueDelete(results);
+      requests = nullptr;
+      results = nullptr;
+      return false;
+    }
+    return true;
   }
 
-  virtual bool poll()
+  // Never blocks: a full queue or a poll already in flight is simply skipped
+  bool submit(PollingTimer *timer)
   {
-    bool success = pollImpl();
-    if (success)
+    if (requests == nullptr || !timer->beginPoll())
     {
-      lastPollTime = time(nullptr);
+      return false;
     }
-    return success;
+
+    Request request = {JOB_POLL, timer};
+    if (xQueueSend(requests, &request, 0) != pdTRUE)
+    {
+      timer->endPoll();
+      return false;
+    }
+    return true;
   }
 
-  // Override to identify as pollable
-  bool isPollable() const override { return true; }
+  // Goes ahead of any polls already waiting, so they find their hosts resolved
+  bool submitPrefetch()
+  {
+    Request request = {JOB_PREFETCH, nullptr};
+    return requests != nullptr && xQueueSendToFront(requests, &request, 0) == pdTRUE;
+  }
 
-  // Override to check and perform polling if needed
-  bool checkPoll(time_t currentTime) override
+  // Queues a PollBench run over timers; the caller wakes once it has finished
+  bool submitBench(Timer **timers, uint8_t count)
   {
-    if (shouldPoll(currentTime))
+    Request request = {JOB_BENCH, nullptr};
+    benchTimers = timers;
+    benchCount = count;
+    benchRunning.store(true);
+    if (requests == nullptr || xQueueSend(requests, &request, 0) != pdTRUE)
     {
-      return poll();
+      benchRunning.store(false);
+      return false;
     }
-    return false;
+    return true;
   }
 
-protected:
-  virtual bool pollImpl() = 0;
+  bool isBenchRunning() const
+  {
+    return benchRunning.load();
+  }
+
+  // Non-blocking; returns false once no completed polls are waiting
+  bool receive(PollResult &result)
+  {
+    return results != nullptr && xQueueReceive(results, &result, 0) == pdTRUE;
+  }
 };
 
-class GitHubPollingTimer : public PollingTimer
+NetworkTask networkTask;
+
+// Set on the UI task while a new timer config waits for polls in flight to finish
+bool timersReloading = false;
+// Set from when a POLL_BENCH run starts waiting for polls in flight until it ends
+bool pollBenchActive = false;
+
+bool queuePoll(PollingTimer *timer)
+{
+  return !timersReloading && !pollBenchActive && networkTask.submit(timer);
+}
+
+// Keeps every PollingTimer on a min-heap ordered by its next due time, so
+// timers stay fresh whether or not they are on screen. Only the top of the
+// heap is inspected per loop, and outside a sync (see syncAll()) submissions
+// are spaced POLL_SPACING_MS apart so several deadlines falling together never
+// stack up in one iteration.
+// Nothing is submitted while the network is down, so offline time does not
+// burn through retries, or before the clock is synced, so lastPollTime and
+// the weather history window are never taken from a provisional clock.
+// While the display sleeps, every interval is stretched ASLEEP_POLL_STRETCH
+// times; waking it makes whatever that left overdue sync at once.
+class PollScheduler
 {
 private:
-  static const size_t MAX_USERNAME_LENGTH = 39;
-  char githubUser[MAX_USERNAME_LENGTH + 1]; // +1 for null terminator
-  static const uint32_t DEFAULT_POLL_INTERVAL = 300;
-  WiFiClientSecure client;
+  struct Entry
+  {
+    time_t due;
+    PollingTimer *timer;
+  };
+
+  NetworkTask &network;
+  Entry heap[MAX_POLLING_TIMERS];
+  uint8_t size;
+  unsigned long lastSubmitMs;
+  bool submitted;
+  bool online;
+  bool clockSynced;
+  bool paused;
+  bool syncing; // Submitting without spacing until nothing is due
+  bool stretched;
+
+  // std heap functions build a max-heap, so invert the comparison
+  static bool dueLater(const Entry &a, const Entry &b)
+  {
+    return a.due > b.due;
+  }
 
-public:
-  GitHubPollingTimer(const char *displayName,
-                     const char *username,
-                     uint32_t pollInterval = DEFAULT_POLL_INTERVAL,
-                     time_t initialTime = time(nullptr))
-      : PollingTimer(displayName, pollInterval, initialTime)
+  time_t dueTime(const PollingTimer *timer) const
   {
-    Serial.println("Starting GitHub timer constructor");
+    time_t due = timer->nextPollTime();
+    return stretched ? due + (time_t)timer->currentInterval() * (ASLEEP_POLL_STRETCH - 1) : due;
+  }
 
-    // Check username length before copying
-    if (strlen(username) > MAX_USERNAME_LENGTH)
+  void refreshDueTimes()
+  {
+    for (uint8_t i = 0; i < size; i++)
     {
-      Serial.println("Error: GitHub username exceeds maximum length of 39 characters");
-      throw std::invalid_argument("GitHub username too long");
+      heap[i].due = dueTime(heap[i].timer);
     }
+    std::make_heap(heap, heap + size, dueLater);
+  }
 
-    strcpy(githubUser, username);
-    client.setInsecure();
-
-    if (poll())
-    {
-      Serial.println("Initial GitHub poll successful");
-    }
+  void push(PollingTimer *timer, time_t due)
+  {
+    heap[size++] = {due, timer};
+    std::push_heap(heap, heap + size, dueLater);
   }
 
-protected:
-  bool pollImpl() override
+  // Manual refreshes can complete while the timer is still queued here
+  void reschedule(PollingTimer *timer, time_t due)
   {
-    Serial.println("Starting GitHub poll");
-    if (WiFi.status() != WL_CONNECTED)
+    for (uint8_t i = 0; i < size; i++)
     {
-      Serial.println("WiFi not connected");
-      return false;
+      if (heap[i].timer == timer)
+      {
+        heap[i].due = due;
+        std::make_heap(heap, heap + size, dueLater);
+        return;
+      }
     }
 
-    HTTPClient http;
-    http.setTimeout(5000);
+    if (size < MAX_POLLING_TIMERS)
+    {
+      push(timer, due);
+    }
+  }
 
-    char url[96];
-    snprintf(url, sizeof(url), "https://api.github.com/users/%s/events", githubUser);
-    Serial.printf("Polling URL: %s\n", url);
+public:
+  PollScheduler(NetworkTask &networkTask)
+      : network(networkTask), size(0), lastSubmitMs(0), submitted(false), online(false), clockSynced(false),
+        paused(false), syncing(true), stretched(false) {}
 
-    if (!http.begin(client, url))
+  bool add(PollingTimer *timer)
+  {
+    if (size >= MAX_POLLING_TIMERS)
     {
-      Serial.println("HTTP begin failed");
+      LOG_ERROR("Too many polling timers for scheduler");
       return false;
     }
 
-    http.addHeader("Accept", "application/vnd.github.v3+json");
-    http.addHeader("User-Agent", "ESP32");
-
-    int httpCode = http.GET();
-    Serial.printf("HTTP Response code: %d\n", httpCode);
-    bool success = false;
+    push(timer, dueTime(timer));
+    return true;
+  }
 
-    if (httpCode == HTTP_CODE_OK)
+  void addAll(Timer **timers, uint8_t count)
+  {
+    for (uint8_t i = 0; i < count; i++)
     {
-      String response = http.getString();
-
-      JsonDocument filter;
-      filter[0]["created_at"] = true;
-
-      JsonDocument doc;
-      DeserializationError error = deserializeJson(doc, response.c_str(), DeserializationOption::Filter(filter));
-
-      if (error)
+      if (timers[i]->isPollable())
       {
-        Serial.printf("JSON parse error: %s\n", error.c_str());
-      }
-
-      if (!error && doc[0]["created_at"])
-      {
-        const char *dateStr = doc[0]["created_at"];
-        Serial.printf("Found date string: %s\n", dateStr);
-        struct tm tm = {0};
-        if (strptime(dateStr, "%Y-%m-%dT%H:%M:%S", &tm) != NULL)
-        {
-          time_t eventTime = mktime(&tm);
-          time_t currentTime = time(nullptr);
-          Serial.printf("Event time: %ld, Current time: %ld\n", (long)eventTime, (long)currentTime);
-          trigger(eventTime);
-          success = true;
-        }
+        add(static_cast<PollingTimer *>(timers[i]));
       }
     }
+  }
 
-    http.end();
-    return success;
+  // Forgets every timer. Only call once drain() has handled every completion,
+  // since results point at the timer they came from.
+  void clear()
+  {
+    size = 0;
   }
-};
 
-class BlueskyPollingTimer : public PollingTimer
-{
-private:
-  static const size_t MAX_HANDLE_LENGTH = 253;
-  char handle[MAX_HANDLE_LENGTH + 1]; // +1 for null terminator
-  static const uint32_t DEFAULT_POLL_INTERVAL = 300;
-  WiFiClientSecure client;
+  time_t nextDeadline() const
+  {
+    return size > 0 ? heap[0].due : 0;
+  }
 
-public:
-  BlueskyPollingTimer(const char *displayName,
-                      const char *userHandle,
-                      uint32_t pollInterval = DEFAULT_POLL_INTERVAL,
-                      time_t initialTime = time(nullptr))
-      : PollingTimer(displayName, pollInterval, initialTime)
+  // Coming back online drops the backoff built up by failed polls, so
+  // anything stale refreshes straight away. Server-imposed waits still hold.
+  void setOnline(bool connected)
   {
-    Serial.println("Starting Bluesky timer constructor");
+    online = connected;
+    if (!connected)
+    {
+      return;
+    }
 
-    // Check handle length before copying
-    if (strlen(handle) > MAX_HANDLE_LENGTH)
+    for (uint8_t i = 0; i < size; i++)
     {
-      Serial.println("Error: Bluesky handle exceeds maximum length of 253 characters");
-      throw std::invalid_argument("Bluesky handle too long");
+      heap[i].timer->clearBackoff();
     }
+    refreshDueTimes();
+  }
 
-    strcpy(handle, userHandle);
-    handle[sizeof(handle) - 1] = '\0';
+  void setClockSynced(bool synced)
+  {
+    clockSynced = synced;
+  }
 
-    client.setInsecure();
+  // The next time polls can go out, every due timer is submitted together
+  // rather than POLL_SPACING_MS apart. Set from the start, so the first sync
+  // after boot fills in every screen in about the time of the slowest poll.
+  void syncAll()
+  {
+    syncing = true;
+  }
 
-    if (poll())
+  void setStretched(bool stretch)
+  {
+    if (stretch == stretched)
     {
-      Serial.println("Initial Bluesky poll successful");
+      return;
     }
+    stretched = stretch;
+    refreshDueTimes();
+    if (!stretch)
+    {
+      syncAll();
+    }
+  }
+
+  // Completions are still handled while paused, but nothing new is submitted
+  void setPaused(bool pause)
+  {
+    paused = pause;
   }
 
-protected:
-  bool pollImpl() override
+  // Handles every completion waiting, even while paused
+  void drain()
   {
-    Serial.println("Starting Bluesky poll");
-    if (WiFi.status() != WL_CONNECTED)
+    PollResult result;
+    while (network.receive(result))
     {
-      Serial.println("WiFi not connected");
-      return false;
+      // Covers both the regular interval and the backoff after a failure
+      reschedule(result.timer, dueTime(result.timer));
     }
+  }
 
-    HTTPClient http;
-    http.setTimeout(5000);
-
-    // Using Bluesky API endpoint
-    char url[128];
-    snprintf(url, sizeof(url), "https://bsky.social/xrpc/com.atproto.repo.listRecords?repo=%s&collection=app.bsky.feed.post", handle);
-    Serial.printf("Polling URL: %s\n", url);
+  void update(time_t now)
+  {
+    drain();
 
-    if (!http.begin(client, url))
+    if (!online || !clockSynced || paused || size == 0)
     {
-      Serial.println("HTTP begin failed");
-      return false;
+      return;
     }
-
-    int httpCode = http.GET();
-    Serial.printf("HTTP Response code: %d\n", httpCode);
-    bool success = false;
-
-    if (httpCode == HTTP_CODE_OK)
+    if (heap[0].due > now)
     {
-      String response = http.getString();
+      syncing = false;
+      return;
+    }
 
-      JsonDocument filter;
-      filter["records"][0]["value"]["createdAt"] = true;
+    unsigned long nowMs = millis();
+    if (!syncing && submitted && nowMs - lastSubmitMs < POLL_SPACING_MS)
+    {
+      return;
+    }
 
-      JsonDocument doc;
-      DeserializationError error = deserializeJson(doc, response.c_str(), DeserializationOption::Filter(filter));
+    // While syncing, everything due goes out at once for the workers to share
+    do
+    {
+      std::pop_heap(heap, heap + size, dueLater);
+      PollingTimer *timer = heap[--size].timer;
 
-      if (error)
+      if (network.submit(timer))
       {
-        Serial.printf("JSON parse error: %s\n", error.c_str());
+        lastSubmitMs = nowMs;
+        submitted = true;
       }
-
-      if (!error && doc["records"][0]["value"]["createdAt"])
+      else if (!timer->isPollInFlight())
       {
-        const char *dateStr = doc["records"][0]["value"]["createdAt"];
-        Serial.printf("Found date string: %s\n", dateStr);
-        struct tm tm = {0};
-        if (strptime(dateStr, "%Y-%m-%dT%H:%M:%S", &tm) != NULL)
-        {
-          time_t eventTime = mktime(&tm);
-          trigger(eventTime);
-          success = true;
-        }
+        // Queue was full; try again shortly. An in-flight poll re-adds itself on completion.
+        push(timer, now + 1);
       }
-    }
-
-    http.end();
-    return success;
+    } while (syncing && size > 0 && heap[0].due <= now);
   }
 };
 
-class WeatherPollingTimer : public PollingTimer
+PollScheduler pollScheduler(networkTask);
+
+// Snapshots timers into NVS so a reboot shows the last known values at once
+// and only refreshes them in the background. Runs on the UI task and skips
+// any timer the network task is currently polling.
+class TimerPersistence
 {
 private:
-  float latitude;
-  float longitude;
-  float currentTemp;
-  char displayName[32];                              // Store the full display name here
-  static const uint32_t DEFAULT_POLL_INTERVAL = 900; // 15 minutes
-  WiFiClientSecure client;
-
-  time_t findLastAboveZero()
-  {
-    time_t now = time(nullptr);
-    time_t startTime = now - (30 * 24 * 60 * 60); // Get 30 days of history
-    char url[256];
-
-    // Format the dates for Open-Meteo
-    struct tm timeinfo;
-    char startDate[11], endDate[11];
-    gmtime_r(&startTime, &timeinfo);
-    strftime(startDate, sizeof(startDate), "%Y-%m-%d", &timeinfo);
-    gmtime_r(&now, &timeinfo);
-    strftime(endDate, sizeof(endDate), "%Y-%m-%d", &timeinfo);
-
-    snprintf(url, sizeof(url),
-             "https://archive-api.open-meteo.com/v1/archive?"
-             "latitude=%.4f&longitude=%.4f&start_date=%s&end_date=%s"
-             "&hourly=temperature_2m",
-             latitude, longitude, startDate, endDate);
-
-    HTTPClient http;
-    if (!http.begin(client, url))
-      return now;
-
-    int httpCode = http.GET();
-    time_t lastAboveZero = now;
-
-    if (httpCode == HTTP_CODE_OK)
-    {
-      String response = http.getString();
-      JsonDocument doc;
-      DeserializationError error = deserializeJson(doc, response);
-
-      if (!error && doc["hourly"]["time"].is<JsonArray>() &&
-          doc["hourly"]["temperature_2m"].is<JsonArray>())
-      {
-        JsonArray times = doc["hourly"]["time"];
-        JsonArray temps = doc["hourly"]["temperature_2m"];
-
-        bool foundAboveZero = false;
-        // Search from most recent to oldest
-        for (int i = times.size() - 1; i >= 0; i--)
-        {
-          float temp = temps[i];
-          const char *timeStr = times[i];
-
-          if (temp > 0.0f)
-          {
-            // Convert ISO time string to epoch
-            struct tm tm = {};
-            strptime(timeStr, "%Y-%m-%dT%H:%M", &tm);
-            lastAboveZero = mktime(&tm);
-            foundAboveZero = true;
-            break;
-          }
-        }
-
-        if (!foundAboveZero)
-        {
-          lastAboveZero = startTime;
-        }
-      }
+  TimerStore &store;
+  ClockSync &clock;
+  Timer **timers;
+  uint8_t timerCount;
+  uint32_t restored; // Bit per timer with state read back from flash
+  unsigned long lastCheckMs;
+  unsigned long lastBatchMs;
+
+  bool snapshot(Timer *timer, TimerState &state)
+  {
+    if (timer->isPollable() && static_cast<PollingTimer *>(timer)->isPollInFlight())
+    {
+      return false;
     }
 
-    http.end();
-    return lastAboveZero;
+    // Zero padding too, so unchanged state compares equal to the stored blob
+    memset(&state, 0, sizeof(state));
+    state.version = TIMER_STATE_VERSION;
+    timer->saveState(state);
+    return true;
   }
 
 public:
-  WeatherPollingTimer(const char *displayName,
-                      float lat, float lon,
-                      uint32_t pollInterval = DEFAULT_POLL_INTERVAL)
-      : PollingTimer(displayName, pollInterval, time(nullptr)),
-        latitude(lat), longitude(lon), currentTemp(0.0f)
+  TimerPersistence(TimerStore &timerStore, ClockSync &clockSync)
+      : store(timerStore), clock(clockSync), timers(nullptr), timerCount(0), restored(0), lastCheckMs(0),
+        lastBatchMs(0) {}
+
+  // Returns the newest trigger time read back, 0 if there was none
+  time_t restore(Timer **timerArray, uint8_t count)
   {
-    client.setInsecure();
-    time_t lastAboveZero = findLastAboveZero();
-    trigger(lastAboveZero);
+    timers = timerArray;
+    timerCount = count;
+    restored = 0;
+    lastCheckMs = lastBatchMs = millis();
+
+    time_t newest = 0;
+    for (uint8_t i = 0; i < timerCount; i++)
+    {
+      TimerState state;
+      if (store.load(timers[i]->getDisplayName(), state))
+      {
+        timers[i]->restoreState(state);
+        newest = std::max(newest, timers[i]->getLastTriggerTime());
+        restored |= 1u << i;
+        LOG_INFO("Restored %s", timers[i]->getDisplayName());
+      }
+      const TriggerHistory &history = timers[i]->getHistory();
+      if (store.loadHistory(timers[i]->getDisplayName(), timers[i]->getHistory()) && history.size() > 0)
+      {
+        newest = std::max(newest, history.at(history.size() - 1));
+        restored |= 1u << i;
+      }
+    }
+    return newest;
   }
 
-protected:
-  bool pollImpl() override
+  // The clock was reseeded by delta. Timers with nothing restored only hold
+  // times stamped since boot, which move with it.
+  void shiftUnrestored(int32_t delta)
   {
-    Serial.println("Starting Weather poll");
-    if (WiFi.status() != WL_CONNECTED)
+    for (uint8_t i = 0; i < timerCount; i++)
     {
-      Serial.println("WiFi not connected");
-      return false;
+      if ((restored & (1u << i)) == 0)
+      {
+        timers[i]->reanchor(0, delta);
+      }
     }
+  }
 
-    HTTPClient http;
-    char url[128];
-    snprintf(url, sizeof(url),
-             "https://api.open-meteo.com/v1/forecast?"
-             "latitude=%.4f&longitude=%.4f"
-             "&current=temperature_2m",
-             latitude, longitude);
-
-    Serial.printf("Polling URL: %s\n", url);
-
-    if (!http.begin(client, url))
+  void update(unsigned long nowMs)
+  {
+    if (nowMs - lastCheckMs < TIMER_SAVE_CHECK_MS)
     {
-      Serial.println("HTTP begin failed");
-      return false;
+      return;
     }
+    lastCheckMs = nowMs;
 
-    int httpCode = http.GET();
-    Serial.printf("HTTP Response code: %d\n", httpCode);
-    bool success = false;
-
-    if (httpCode == HTTP_CODE_OK)
+    bool batchDue = nowMs - lastBatchMs >= TIMER_SAVE_BATCH_MS;
+    if (batchDue)
     {
-      String response = http.getString();
-      Serial.printf("Response: %s\n", response.c_str());
-
-      JsonDocument doc;
-      DeserializationError error = deserializeJson(doc, response);
+      lastBatchMs = nowMs;
+    }
+    save(batchDue);
+  }
 
-      if (error)
+  // Polling timers are only written with the batch unless includePolling is
+  // set, and histories, which change with every trigger, only with the batch
+  void save(bool includePolling)
+  {
+    bool wrote = false;
+    for (uint8_t i = 0; i < timerCount; i++)
+    {
+      TimerState state;
+      if ((includePolling || !timers[i]->isPollable()) && snapshot(timers[i], state) &&
+          store.save(timers[i]->getDisplayName(), state))
       {
-        Serial.printf("JSON parse error: %s\n", error.c_str());
+        LOG_INFO("Saved %s", timers[i]->getDisplayName());
+        wrote = true;
       }
-
-      if (!error && doc["current"]["temperature_2m"].is<float>())
+      if (includePolling && store.saveHistory(timers[i]->getDisplayName(), timers[i]->getHistory()))
       {
-        currentTemp = doc["current"]["temperature_2m"];
-        Serial.printf("Current temperature: %.1f°C\n", currentTemp);
-
-        if (currentTemp > 0.0f)
-        {
-          Serial.println("Temperature above 0°C, updating trigger time");
-          trigger(time(nullptr));
-        }
-        success = true;
+        LOG_INFO("Saved %s history", timers[i]->getDisplayName());
+        wrote = true;
       }
     }
-
-    http.end();
-    return success;
+    // A seed behind what was just written would put those times in the future after a power loss
+    if (wrote)
+    {
+      clock.checkpoint();
+    }
   }
 };
 
-// Class to manage timer display and button interaction
-class TimerDisplay
+TimerStore timerStore;
+ClockSync clockSync;
+TimerPersistence timerPersistence(timerStore, clockSync);
+
+// Device-wide timings, recorded on the UI task
+struct DeviceMetrics
 {
-private:
-  Timer **timers;
-  uint8_t timerCount;
-  uint8_t currentIndex;
-  uint8_t actionButtonPin;
-  LiquidCrystal_I2C &lcd;
-  String lastName;
-  int32_t lastSeconds;
+  LatencyHistogram loopTime; // One loop() iteration, excluding the wait
+  LatencyHistogram lcdWrite; // Sending changed cells over I2C
+};
 
-public:
-  TimerDisplay(Timer **timerArray, uint8_t count, uint8_t buttonPin, LiquidCrystal_I2C &lcdDisplay)
-      : timers(timerArray), timerCount(count), currentIndex(0),
-        actionButtonPin(buttonPin), lcd(lcdDisplay),
-        lastName(""), lastSeconds(-1) {}
+DeviceMetrics deviceMetrics;
 
-  void update(time_t now)
-  {
-    // Check if current timer needs polling
-    if (Timer *current = getCurrentTimer())
-    {
-      if (current->isPollable())
-      {
-        current->checkPoll(now);
-      }
-    }
+// Milliseconds until just past the next wall-clock second, when the display changes
+uint32_t msUntilNextSecond()
+{
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return 1000 - tv.tv_usec / 1000;
+}
 
-    checkButton(now);
-    updateDisplay(now);
-    checkNavigationButtons();
+// Lets the idle task drop into light sleep between wakeups, with the radio in
+// modem sleep between DTIM beacons. Needs CONFIG_PM_ENABLE and tickless idle
+// in the SDK configuration; without them the loop still blocks instead of spinning.
+void enablePowerSaving()
+{
+  WiFi.setSleep(WIFI_PS_MIN_MODEM);
+
+#if ESP_IDF_VERSION_MAJOR >= 5
+  esp_pm_config_t pm = {};
+#else
+  esp_pm_config_esp32_t pm = {};
+#endif
+  pm.max_freq_mhz = CPU_MAX_FREQ_MHZ;
+  pm.min_freq_mhz = CPU_MIN_FREQ_MHZ;
+  pm.light_sleep_enable = true;
+
+  esp_err_t err = esp_pm_configure(&pm);
+  if (err != ESP_OK)
+  {
+    LOG_WARN("Automatic light sleep unavailable: %s", esp_err_to_name(err));
   }
+}
 
-  // Check button and trigger current timer if pressed
-  void checkButton(time_t currentTime)
-  {
-    static bool lastButtonState = HIGH;
-    bool currentButtonState = digitalRead(actionButtonPin);
+// PCF8574T, IIC address is 0x27, PCF8574AT is 0x3F.
+LiquidCrystal_I2C lcd(0x27, 16, 2);
 
-    if (currentButtonState == LOW && lastButtonState == HIGH)
-    {
-      // Clear timestamp so no characters linger
-      lcd.setCursor(0, 1);
-      lcd.print("                ");
+#ifdef STATIC_TIMERS
+// Fixed at build time instead of read from LittleFS. There is no /config, and
+// providers not listed here are left out of the image.
+TimerTable<ButtonTimer, GitHubPollingTimer, BlueskyPollingTimer, WeatherPollingTimer> timerPool(
+    [] { return ButtonTimer("Last drank water"); },
+    [] { return GitHubPollingTimer("Last GitHub push", "evjrob", 300); },
+    [] { return BlueskyPollingTimer("Last Bsky post", "evjrob.bsky.social", 300); },
+    [] { return WeatherPollingTimer("Last above 0"
+                                    "\xDF"
+                                    "C",
+                                    49.8954f, -97.1385f, 900); });
+#else
+// Built from the config on LittleFS; replaced in place when a new one is posted
+TimerPool timerPool;
+#endif
+std::atomic<bool> timerConfigChanged(false);
+
+ButtonInput buttonInput(BUTTON_DEBOUNCE_DELAY);
+AmbientLight ambientLight;
 
-      timers[currentIndex]->handleButtonPress(currentTime);
-    }
+// Create display controller
+TimerDisplay *timerDisplay;
 
-    lastButtonState = currentButtonState;
+WifiManager wifiManager;
+LocalServer localServer;
+TaskHandle_t uiTask; // Woken by pushes so the display redraws at once
+bool pollBenchQueued = false;
+bool pollBenchDone = false;
 
-    delay(BUTTON_DEBOUNCE_DELAY); // Simple debounce
+// Pushes and config changes carry "Authorization: Bearer <PUSH_TOKEN>"
+bool authorized(LocalRequest &request)
+{
+  char auth[96];
+  bool present = request.header("Authorization", auth, sizeof(auth));
+  if (strlen(PUSH_TOKEN) == 0 || !present || strncmp(auth, "Bearer ", 7) != 0 || strcmp(auth + 7, PUSH_TOKEN) != 0)
+  {
+    request.send(401, "text/plain", "Unauthorized\n");
+    return false;
   }
+  return true;
+}
 
-  void nextTimer()
+// POST /trigger?timer=<display name>[&time=<unix seconds>]. Lets a webhook
+// relay update a timer at once instead of waiting for its next poll.
+void handleTriggerPush()
+{
+  LocalRequest &request = localServer.request();
+  if (!authorized(request))
   {
-    currentIndex = (currentIndex + 1) % timerCount;
+    return;
   }
 
-  void previousTimer()
+  time_t now = time(nullptr);
+  time_t eventTime = now;
+  char text[24];
+  if (request.arg("time", text, sizeof(text)))
   {
-    currentIndex = (currentIndex - 1) % timerCount;
+    char *end;
+    eventTime = strtol(text, &end, 10);
+    if (text[0] == '\0' || *end != '\0' || eventTime > now + PUSH_MAX_CLOCK_SKEW_SEC)
+    {
+      request.send(400, "text/plain", "Bad time\n");
+      return;
+    }
+    // A relay a little ahead of this clock still counts as now, never as the future
+    eventTime = std::min(eventTime, now);
   }
 
-  // Get currently selected timer
-  Timer *getCurrentTimer() const
+  char name[TIMER_NAME_SIZE];
+  if (!request.arg("timer", name, sizeof(name)))
   {
-    return timers[currentIndex];
+    request.send(404, "text/plain", "Unknown timer\n");
+    return;
   }
 
-private:
-  void updateDisplay(time_t now)
+  timerPool.lock();
+  Timer *timer = timerPool.find(name);
+  if (timer != nullptr)
   {
-    Timer *current = getCurrentTimer();
-    String name = current->getDisplayName();
-    int32_t seconds = current->timeSince(now);
+    timer->onPush(eventTime);
+    LOG_INFO("Push for %s at %ld", timer->getDisplayName(), (long)eventTime);
+  }
+  timerPool.unlock();
 
-    if (name != lastName || seconds != lastSeconds)
-    {
-      if (name != lastName)
-      {
-        lcd.clear();
-        lcd.setCursor(0, 0);
-        lcd.print(name);
-        lastName = name;
-      }
+  if (timer == nullptr)
+  {
+    request.send(404, "text/plain", "Unknown timer\n");
+    return;
+  }
+  request.send(204);
+  xTaskNotifyGive(uiTask);
+}
+
+#ifndef STATIC_TIMERS
+// GET /config returns the timer config in use
+void handleConfigGet()
+{
+  LocalRequest &request = localServer.request();
+  File file = LittleFS.open(TIMER_CONFIG_PATH, "r");
+  if (!file)
+  {
+    request.send(200, "application/json", DEFAULT_TIMER_CONFIG);
+    return;
+  }
 
-      int hours = seconds / 3600;
-      int minutes = (seconds % 3600) / 60;
-      int secs = seconds % 60;
+  request.beginChunked(200, "application/json");
+  char chunk[512];
+  size_t length;
+  while ((length = file.read((uint8_t *)chunk, sizeof(chunk))) > 0)
+  {
+    request.sendChunk(chunk, length);
+  }
+  request.endChunked();
+  file.close();
+}
 
-      char timeStr[16];
-      sprintf(timeStr, "%02d:%02d:%02d", hours, minutes, secs);
+// POST /config with a JSON body replaces the timer config. It is checked
+// before being written, then the UI task rebuilds the timers from it.
+void handleConfigPost()
+{
+  LocalRequest &request = localServer.request();
+  if (!authorized(request))
+  {
+    return;
+  }
 
-      int timeStrLen = strlen(timeStr);
-      int startPos = max(0, 16 - timeStrLen);
+  size_t length = request.bodyLength();
+  if (length == 0 || length > TIMER_CONFIG_MAX_SIZE)
+  {
+    request.send(413, "text/plain", "Config missing or too large\n");
+    return;
+  }
+  // Too big for the server task's stack; only held for this request
+  std::unique_ptr<char[]> body(new (std::nothrow) char[length]);
+  if (!body || !request.readBody(body.get()))
+  {
+    request.send(400, "text/plain", "Could not read config\n");
+    return;
+  }
 
-      lcd.setCursor(startPos, 1);
-      lcd.print(timeStr);
+  JsonDocument doc;
+  char error[64];
+  DeserializationError parseError = deserializeJson(doc, body.get(), length);
+  if (parseError)
+  {
+    snprintf(error, sizeof(error), "%s", parseError.c_str());
+  }
+  if (parseError || !TimerPool::validate(doc, error, sizeof(error)))
+  {
+    char message[80];
+    snprintf(message, sizeof(message), "Bad config: %s\n", error);
+    request.send(400, "text/plain", message);
+    return;
+  }
 
-      lastSeconds = seconds;
-    }
+  // Written beside the old file and renamed over it, so a reset mid-write keeps the old config
+  File file = LittleFS.open(TIMER_CONFIG_PATH ".new", "w");
+  bool written = file && file.write((const uint8_t *)body.get(), length) == length;
+  file.close();
+  if (!written || !LittleFS.rename(TIMER_CONFIG_PATH ".new", TIMER_CONFIG_PATH))
+  {
+    LittleFS.remove(TIMER_CONFIG_PATH ".new");
+    request.send(500, "text/plain", "Could not save config\n");
+    return;
   }
 
-  void checkNavigationButtons()
+  LOG_INFO("New timer config saved");
+  timerConfigChanged.store(true);
+  request.send(202, "text/plain", "Reloading\n");
+  xTaskNotifyGive(uiTask);
+}
+#endif
+
+// GET /metrics in the Prometheus text format
+void handleMetrics()
+{
+  MetricsWriter out(localServer.request());
+  out.begin();
+
+  char labels[96];
+  MetricsWriter::label(labels, sizeof(labels), "version", FIRMWARE_VERSION);
+  out.type("firmware_build_info", "gauge");
+  out.gauge("firmware_build_info", labels, 1);
+  out.type("uptime_seconds", "gauge");
+  out.gauge("uptime_seconds", "", millis() / 1000);
+  out.type("ambient_light_level", "gauge");
+  out.gauge("ambient_light_level", "", ambientLight.getLevel());
+  out.type("display_asleep", "gauge");
+  out.gauge("display_asleep", "", timerDisplay->isAsleep() ? 1 : 0);
+
+  out.type("heap_free_bytes", "gauge");
+  out.gauge("heap_free_bytes", "", heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+  out.type("heap_min_free_bytes", "gauge");
+  out.gauge("heap_min_free_bytes", "", heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL));
+  out.type("heap_largest_free_block_bytes", "gauge");
+  out.gauge("heap_largest_free_block_bytes", "", heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL));
+  size_t psramTotal = heap_caps_get_total_size(MALLOC_CAP_SPIRAM);
+  out.type("psram_used_bytes", "gauge");
+  out.gauge("psram_used_bytes", "", psramTotal - heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+  out.type("psram_total_bytes", "gauge");
+  out.gauge("psram_total_bytes", "", psramTotal);
+
+  out.type("loop_seconds", "histogram");
+  out.histogram("loop_seconds", "", deviceMetrics.loopTime);
+  out.type("lcd_write_seconds", "histogram");
+  out.histogram("lcd_write_seconds", "", deviceMetrics.lcdWrite);
+
+  static const char *const phaseNames[] = {"dns", "tls", "first_byte", "download", "parse"};
+  out.type("poll_phase_seconds", "histogram");
+  timerPool.lock();
+  timerPool.forEachPolling([&](PollingTimer &timer)
   {
-    if (digitalRead(DOWN_BUTTON) == LOW)
+    const PollPhaseMetrics &phases = timer.getPhaseMetrics();
+    const LatencyHistogram *histograms[] = {&phases.dns, &phases.tls, &phases.firstByte,
+                                            &phases.download, &phases.parse};
+    char timerLabel[48];
+    MetricsWriter::label(timerLabel, sizeof(timerLabel), "timer", timer.getDisplayName());
+    for (uint8_t i = 0; i < sizeof(phaseNames) / sizeof(phaseNames[0]); i++)
     {
-      nextTimer();
-      delay(BUTTON_DEBOUNCE_DELAY);
+      char phaseLabel[24];
+      MetricsWriter::label(phaseLabel, sizeof(phaseLabel), "phase", phaseNames[i]);
+      snprintf(labels, sizeof(labels), "%s,%s", timerLabel, phaseLabel);
+      out.histogram("poll_phase_seconds", labels, *histograms[i]);
     }
+  });
 
-    if (digitalRead(UP_BUTTON) == LOW)
-    {
-      previousTimer();
-      delay(BUTTON_DEBOUNCE_DELAY);
-    }
-  }
-};
+  // Shows adaptive timers settling between their interval and max_interval
+  out.type("poll_interval_seconds", "gauge");
+  timerPool.forEachPolling([&](PollingTimer &timer)
+  {
+    MetricsWriter::label(labels, sizeof(labels), "timer", timer.getDisplayName());
+    out.gauge("poll_interval_seconds", labels, timer.currentInterval());
+  });
+  timerPool.unlock();
 
-void initTime()
-{
-  configTime(GMT_OFFSET_SEC, DAYLIGHT_OFFSET_SEC, NTP_SERVER);
+  out.finish();
+}
 
-  time_t now = 0;
-  while (now < 24 * 3600)
+#ifndef STATIC_TIMERS
+void loadTimers()
+{
+  if (timerPool.load(LittleFS, TIMER_CONFIG_PATH) || timerPool.load(DEFAULT_TIMER_CONFIG))
   {
-    delay(500);
-    now = time(nullptr);
+    LOG_INFO("%u timers configured", (unsigned)timerPool.size());
   }
 }
 
-// PCF8574T, IIC address is 0x27, PCF8574AT is 0x3F.
-LiquidCrystal_I2C lcd(0x27, 16, 2);
+// Rebuilds the timers from a newly posted config. The old ones are freed only
+// once no poll still holds one, so this is called on every loop until the
+// network task has finished what it was given; completions wake the loop.
+void reloadTimers()
+{
+  if (!timersReloading)
+  {
+    timersReloading = true;
+    pollScheduler.setPaused(true);
+  }
 
-// Create array of timer pointers. Adjust size as needed
-Timer *timerArray[4];
+  bool inFlight = false;
+  timerPool.forEachPolling([&](PollingTimer &timer) { inFlight = inFlight || timer.isPollInFlight(); });
+  if (inFlight)
+  {
+    return;
+  }
 
-// Create display controller
-TimerDisplay *timerDisplay;
+  // With nothing in flight every result is queued; handle them while their timers still exist
+  pollScheduler.drain();
+  timerPersistence.save(true);
+
+  timerPool.lock();
+  pollScheduler.clear();
+  loadTimers();
+  timerPersistence.restore(timerPool.all(), timerPool.size());
+  timerPool.forEachPolling([](auto &timer) { timer.addHosts(connectionPool.dns()); });
+  timerDisplay->setTimers(timerPool.all(), timerPool.size());
+  pollScheduler.addAll(timerPool.all(), timerPool.size());
+  timerPool.unlock();
+
+  pollScheduler.syncAll();
+  pollScheduler.setPaused(false);
+  timersReloading = false;
+}
+#endif
 
-void connectToWifi()
+#ifdef POLL_BENCH
+// Runs once the device is online with a synced clock. Polling pauses and the
+// bench waits for polls in flight, so it never shares a timer or a connection
+// with a regular poll; every timer resyncs once it is done.
+void updatePollBench()
 {
-  Serial.print("Connecting to WiFi");
-  WiFi.mode(WIFI_STA);
-  WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
-
-  unsigned long startAttemptTime = millis();
-
-  // Keep looping while we're not connected and haven't reached the timeout
-  while (WiFi.status() != WL_CONNECTED &&
-         millis() - startAttemptTime < WIFI_TIMEOUT_MS)
+  if (pollBenchDone)
   {
-    Serial.print(".");
-    delay(100);
+    return;
+  }
+  if (!pollBenchActive)
+  {
+    if (!wifiManager.isConnected() || !clockSync.isSynced() || timersReloading)
+    {
+      return;
+    }
+    pollBenchActive = true;
+    pollScheduler.setPaused(true);
   }
 
-  if (WiFi.status() != WL_CONNECTED)
+  if (!pollBenchQueued)
   {
-    Serial.println("\nFailed to connect to WiFi!");
+    bool inFlight = false;
+    timerPool.forEachPolling([&](PollingTimer &timer) { inFlight = inFlight || timer.isPollInFlight(); });
+    if (!inFlight)
+    {
+      pollScheduler.drain();
+      pollBenchQueued = networkTask.submitBench(timerPool.all(), timerPool.size());
+    }
     return;
   }
 
-  Serial.println("\nConnected!");
-  Serial.print("IP Address: ");
-  Serial.println(WiFi.localIP());
+  if (!networkTask.isBenchRunning())
+  {
+    pollBenchDone = true;
+    pollBenchActive = false;
+    pollScheduler.syncAll();
+    pollScheduler.setPaused(false);
+  }
 }
+#endif
 
 void setup()
 {
+  allocTraceBegin();
   Wire.begin(LCD_SDA, LCD_SCL);
   lcd.init();
+  // After init(), which restarts the bus at its default speed
+  Wire.setClock(LCD_I2C_CLOCK_HZ);
   lcd.backlight();
   lcd.setCursor(0, 0);
   lcd.print("Initializing...");
 
   Serial.begin(115200);
+  logger().begin();
 
-  pinMode(UP_BUTTON, INPUT_PULLUP);
-  pinMode(DOWN_BUTTON, INPUT_PULLUP);
-  pinMode(ACTION_BUTTON, INPUT_PULLUP);
+#ifndef STATIC_TIMERS
+  // Formats on first boot so a config can be posted to a fresh board
+  if (!LittleFS.begin(true))
+  {
+    LOG_ERROR("LittleFS unavailable, using built-in timers");
+  }
+#endif
+
+  // Both return at once; the connection and the time come up in the background
+  wifiManager.begin(WIFI_SSID, WIFI_PASSWORD);
+  clockSync.begin(GMT_OFFSET_SEC, DAYLIGHT_OFFSET_SEC, NTP_SERVER);
+
+  LOG_DEBUG("Starting timer initialization");
+#ifndef STATIC_TIMERS
+  timerPool.begin();
+  loadTimers();
+#endif
+  timerStore.begin();
+  int32_t seedShift = clockSync.seedAfter(timerPersistence.restore(timerPool.all(), timerPool.size()));
+  timerPersistence.shiftUnrestored(seedShift);
+
+  timerDisplay = new TimerDisplay(timerPool.all(), timerPool.size(), buttonInput, clockSync, lcd,
+                                  deviceMetrics.lcdWrite);
+  buttonInput.begin(UP_BUTTON, DOWN_BUTTON, ACTION_BUTTON);
+  ambientLight.begin(PHOTORESISTOR);
+
+  // Restored poll times decide what is due; anything stale refreshes in the
+  // background, all at once, while the display shows restored values or a
+  // placeholder
+  connectionPool.begin();
+  timerPool.forEachPolling([](auto &timer) { timer.addHosts(connectionPool.dns()); });
+  networkTask.begin();
+  pollScheduler.addAll(timerPool.all(), timerPool.size());
+  pollScheduler.setClockSynced(clockSync.isSynced());
+
+  uiTask = xTaskGetCurrentTaskHandle();
+  localServer.on("/trigger", HTTP_POST, handleTriggerPush);
+  localServer.on("/metrics", HTTP_GET, handleMetrics);
+#ifndef STATIC_TIMERS
+  localServer.on("/config", HTTP_GET, handleConfigGet);
+  localServer.on("/config", HTTP_POST, handleConfigPost);
+#endif
+  localServer.begin();
+  enablePowerSaving();
+}
 
-  connectToWifi();
-  initTime();
+void loop()
+{
+  uint32_t loopStart = micros();
+  wifiManager.update(millis());
+  bool connected;
+  if (wifiManager.takeChange(connected))
+  {
+    if (connected)
+    {
+      networkTask.submitPrefetch();
+    }
+    pollScheduler.setOnline(connected);
+  }
 
-  time_t now = time(nullptr);
+  time_t since;
+  int32_t correction;
+  if (clockSync.takeSync(since, correction))
+  {
+    if (abs(correction) >= CLOCK_REANCHOR_THRESHOLD_SEC)
+    {
+      timerPool.forEach([&](auto &timer) { timer.reanchor(since, correction); });
+    }
+    pollScheduler.setClockSynced(true);
+  }
+  clockSync.update(millis());
 
-  Serial.println("Starting timer initialization");
-  timerArray[0] = new ButtonTimer("Last drank water", now);
-  timerArray[1] = new GitHubPollingTimer("Last GitHub push", "evjrob", 300, now);
-  timerArray[2] = new BlueskyPollingTimer("Last Bsky post", "evjrob.bsky.social", 300, now);
-  timerArray[3] = new WeatherPollingTimer("Last above 0"
-                                          "\xDF"
-                                          "C",
-                                          49.8954f, -97.1385f, 900);
+  bool dark;
+  if (ambientLight.takeChange(dark))
+  {
+    LOG_INFO("Room is %s", dark ? "dark" : "lit");
+    timerDisplay->setDark(dark);
+  }
 
-  timerDisplay = new TimerDisplay(timerArray, 4, ACTION_BUTTON, lcd);
-}
+#ifdef POLL_BENCH
+  updatePollBench();
+#endif
 
-void loop()
-{
   time_t now = time(nullptr);
+#ifndef STATIC_TIMERS
+  // A config posted during a bench run is applied once it is done
+  if (!pollBenchActive && (timerConfigChanged.exchange(false) || timersReloading))
+  {
+    reloadTimers();
+  }
+#endif
+  pollScheduler.update(now);
   timerDisplay->update(now);
+  bool asleep = timerDisplay->isAsleep();
+  pollScheduler.setStretched(asleep);
+  timerPersistence.update(millis());
+
+  deviceMetrics.loopTime.record(micros() - loopStart);
+
+  // Nothing changes between these wakeups: the next second, a button edge or
+  // settle, or a finished poll. The idle task can light sleep in between.
+  uint32_t waitMs = msUntilNextSecond();
+  if (asleep)
+  {
+    // Nothing is drawn, so only the next poll needs the loop. Lights coming
+    // on or a press wakes it sooner.
+    time_t deadline = pollScheduler.nextDeadline();
+    uint32_t sleepMs = ASLEEP_LOOP_MS;
+    if (deadline != 0)
+    {
+      sleepMs = deadline > now ? std::min<uint32_t>((deadline - now) * 1000, ASLEEP_LOOP_MS) : 0;
+    }
+    waitMs = std::max(waitMs, sleepMs);
+  }
+  waitMs = std::min<uint32_t>(waitMs, buttonInput.msUntilSettled());
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));
 }
\ No newline at end of file
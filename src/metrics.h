@@ -0,0 +1,187 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <stdarg.h>
+#include "local_server.h"
+
+// Bucket upper bounds are 64 us doubling up to about 8.4 s, plus one for slower samples
+#define HISTOGRAM_FIRST_BOUND_US 64
+#define HISTOGRAM_BUCKETS 18
+#define METRICS_BUFFER_SIZE 512
+
+// Latency histogram with power-of-two buckets from 64 us, fine enough for an
+// LCD write or a loop iteration as well as a TLS handshake. The sum is kept in
+// microseconds, 64 bits wide so it does not wrap on a long uptime. Recorded
+// from one task and read from another; each field is individually atomic, so
+// a reader may see a sample counted in one field and not yet in the next.
+class LatencyHistogram
+{
+private:
+  std::atomic<uint32_t> buckets[HISTOGRAM_BUCKETS + 1];
+  std::atomic<uint32_t> count;
+  std::atomic<uint64_t> sumUs;
+
+public:
+  LatencyHistogram() : count(0), sumUs(0)
+  {
+    for (std::atomic<uint32_t> &bucket : buckets)
+    {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  void record(uint32_t us)
+  {
+    uint32_t units = (us + HISTOGRAM_FIRST_BOUND_US - 1) / HISTOGRAM_FIRST_BOUND_US;
+    uint8_t index = units <= 1 ? 0 : 32 - __builtin_clz(units - 1);
+    buckets[index < HISTOGRAM_BUCKETS ? index : HISTOGRAM_BUCKETS].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sumUs.fetch_add(us, std::memory_order_relaxed);
+  }
+
+  // Samples in bucket i took at most bound(i) us; the last bucket has no bound
+  uint32_t bucket(uint8_t i) const
+  {
+    return buckets[i].load(std::memory_order_relaxed);
+  }
+
+  static uint32_t bound(uint8_t i)
+  {
+    return (uint32_t)HISTOGRAM_FIRST_BOUND_US << i;
+  }
+
+  uint32_t getCount() const
+  {
+    return count.load(std::memory_order_relaxed);
+  }
+
+  uint64_t getSumUs() const
+  {
+    return sumUs.load(std::memory_order_relaxed);
+  }
+};
+
+// Where a poll spends its time. DNS and TLS are only recorded when the poll
+// had to open a new connection.
+struct PollPhaseMetrics
+{
+  LatencyHistogram dns;
+  LatencyHistogram tls;
+  LatencyHistogram firstByte; // Request sent until the response headers are in
+  LatencyHistogram download;  // Waiting on the socket while the body is parsed
+  LatencyHistogram parse;     // Parsing, excluding the waits above
+};
+
+// Streams metrics in the Prometheus text format as a chunked response, a
+// buffer at a time, so the page never has to fit in memory. Use from a
+// LocalServer handler.
+class MetricsWriter
+{
+private:
+  LocalRequest &request;
+  char buffer[METRICS_BUFFER_SIZE];
+  size_t used;
+
+  void flush()
+  {
+    if (used > 0)
+    {
+      request.sendChunk(buffer, used);
+      used = 0;
+    }
+  }
+
+  void append(const char *format, ...) __attribute__((format(printf, 2, 3)))
+  {
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+      va_list args;
+      va_start(args, format);
+      int length = vsnprintf(buffer + used, sizeof(buffer) - used, format, args);
+      va_end(args);
+
+      if (length >= 0 && (size_t)length < sizeof(buffer) - used)
+      {
+        used += length;
+        return;
+      }
+      // Lines never come close to a whole buffer, so one flush makes room
+      flush();
+    }
+  }
+
+public:
+  MetricsWriter(LocalRequest &localRequest) : request(localRequest), used(0) {}
+
+  // Formats name="value" for the labels argument of gauge() and histogram().
+  // Values are kept to printable ASCII for text-format parsers.
+  static void label(char *out, size_t size, const char *name, const char *value)
+  {
+    size_t pos = snprintf(out, size, "%s=\"", name);
+    if (pos + 2 > size)
+    {
+      out[0] = '\0';
+      return;
+    }
+    for (; *value != '\0' && pos + 3 < size; value++)
+    {
+      char c = *value;
+      if (c == '"' || c == '\\')
+      {
+        out[pos++] = '\\';
+      }
+      out[pos++] = (c >= ' ' && c <= '~') ? c : '_';
+    }
+    out[pos++] = '"';
+    out[pos] = '\0';
+  }
+
+  void begin()
+  {
+    request.beginChunked(200, "text/plain; version=0.0.4");
+  }
+
+  void finish()
+  {
+    flush();
+    request.endChunked();
+  }
+
+  void type(const char *name, const char *kind)
+  {
+    append("# TYPE %s %s\n", name, kind);
+  }
+
+  void gauge(const char *name, const char *labels, double value)
+  {
+    if (labels[0] == '\0')
+    {
+      append("%s %.15g\n", name, value);
+    }
+    else
+    {
+      append("%s{%s} %.15g\n", name, labels, value);
+    }
+  }
+
+  // Emitted in seconds, with cumulative buckets as the format expects
+  void histogram(const char *name, const char *labels, const LatencyHistogram &histogram)
+  {
+    const char *separator = labels[0] == '\0' ? "" : ",";
+    uint32_t cumulative = 0;
+    for (uint8_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+      cumulative += histogram.bucket(i);
+      append("%s_bucket{%s%sle=\"%.6f\"} %u\n", name, labels, separator,
+             LatencyHistogram::bound(i) / 1000000.0, (unsigned)cumulative);
+    }
+    cumulative += histogram.bucket(HISTOGRAM_BUCKETS);
+    append("%s_bucket{%s%sle=\"+Inf\"} %u\n", name, labels, separator, (unsigned)cumulative);
+    append("%s_sum{%s} %.6f\n", name, labels, histogram.getSumUs() / 1000000.0);
+    append("%s_count{%s} %u\n", name, labels, (unsigned)cumulative);
+  }
+};
+
+#endif
@@ -0,0 +1,177 @@
+#ifndef POLL_BENCH_H
+#define POLL_BENCH_H
+
+#include <Arduino.h>
+#include <algorithm>
+#include <esp_heap_caps.h>
+#include "connection_pool.h"
+#include "json_arena.h"
+#include "logger.h"
+#include "timers.h"
+
+// Build with -DPOLL_BENCH=<iterations> to run the benchmark once the device
+// is online with a synced clock; the results go to the log. Each polling
+// timer costs 2 * iterations + 1 requests against its provider's quota.
+#define POLL_BENCH_MAX_ITERATIONS 64
+// Requests left untouched for regular polling once the bench is done
+#define POLL_BENCH_QUOTA_RESERVE 10
+
+// End-to-end poll cost on real hardware, where TLS and Wi-Fi dominate. Calls
+// each timer's pollImpl() back to back, first cold (pool, DNS cache and
+// validators cleared before every request, so each one pays DNS, the TLS
+// handshake and a full body) and then warm (one keep-alive connection reused
+// throughout, validators still cleared so bodies are comparable). Must run on a network
+// worker, with that worker's arena, once the caller has paused polling and
+// every poll in flight has finished: cold runs close every idle connection.
+// Each timer is still claimed with beginPoll() while it is measured, and one
+// that is busy anyway is skipped. A timer whose rate-limit headers show too
+// little quota left for the rest of its run is skipped or cut short, which
+// matters for GitHub: unauthenticated units get 60 requests an hour per IP,
+// shared with the budget regular polling spreads across RATE_LIMIT_SHARED_UNITS.
+class PollBench
+{
+private:
+  struct Sample
+  {
+    uint32_t wallUs;
+    uint32_t dnsUs;
+    uint32_t tlsUs;
+    size_t bytes;
+    int32_t heapDelta; // Bytes of internal heap still held when the poll returned
+  };
+
+  static uint32_t percentile(uint32_t *values, uint16_t count, uint8_t percent)
+  {
+    std::sort(values, values + count);
+    return values[std::min<uint16_t>(count - 1, (uint32_t)count * percent / 100)];
+  }
+
+  // True once the server has said fewer than needed requests are left, plus the reserve
+  static bool quotaShort(const PollingTimer *timer, uint32_t needed)
+  {
+    int32_t remaining = timer->getQuotaRemaining();
+    return remaining >= 0 && (uint32_t)remaining < needed + POLL_BENCH_QUOTA_RESERVE;
+  }
+
+  static void runCase(PollingTimer *timer, JsonArena &arena, uint16_t iterations, bool cold)
+  {
+    Sample samples[POLL_BENCH_MAX_ITERATIONS];
+    uint16_t failed = 0;
+    uint16_t taken = 0;
+
+    if (!timer->beginPoll())
+    {
+      LOG_WARN("bench %s %s: skipped, poll in flight", timer->getDisplayName(), cold ? "cold" : "warm");
+      return;
+    }
+
+    if (!cold)
+    {
+      // Opens the connection the timed polls then reuse
+      connectionPool.closeAll();
+      timer->clearValidators();
+      timer->pollImpl(arena);
+      arena.reset();
+    }
+
+    for (; taken < iterations; taken++)
+    {
+      if (quotaShort(timer, iterations - taken))
+      {
+        LOG_WARN("bench %s %s: stopped after %u polls, %ld requests left", timer->getDisplayName(),
+                 cold ? "cold" : "warm", (unsigned)taken, (long)timer->getQuotaRemaining());
+        break;
+      }
+      if (cold)
+      {
+        connectionPool.closeAll();
+        connectionPool.dns().flush();
+      }
+      timer->clearValidators();
+
+      size_t freeBefore = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+      uint32_t start = micros();
+      bool ok = timer->pollImpl(arena);
+      uint32_t wallUs = micros() - start;
+      arena.reset();
+      size_t freeAfter = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+
+      const PollCost &cost = timer->getLastPollCost();
+      samples[taken] = {wallUs, cost.openedConnection ? cost.dnsUs : 0, cost.openedConnection ? cost.tlsUs : 0,
+                        cost.bodyBytes, (int32_t)(freeBefore - freeAfter)};
+      failed += ok ? 0 : 1;
+    }
+    timer->endPoll();
+
+    if (taken > 0)
+    {
+      report(timer->getDisplayName(), cold ? "cold" : "warm", samples, taken, failed);
+    }
+  }
+
+  static void report(const char *name, const char *mode, Sample *samples, uint16_t count, uint16_t failed)
+  {
+    uint32_t values[POLL_BENCH_MAX_ITERATIONS];
+    uint64_t wallTotal = 0, dnsTotal = 0, tlsTotal = 0;
+    for (uint16_t i = 0; i < count; i++)
+    {
+      wallTotal += samples[i].wallUs;
+      dnsTotal += samples[i].dnsUs;
+      tlsTotal += samples[i].tlsUs;
+      values[i] = samples[i].wallUs;
+    }
+    uint32_t minUs = *std::min_element(values, values + count);
+    uint32_t medianUs = percentile(values, count, 50);
+    uint32_t p99Us = percentile(values, count, 99);
+
+    for (uint16_t i = 0; i < count; i++)
+    {
+      values[i] = samples[i].bytes;
+    }
+    uint32_t medianBytes = percentile(values, count, 50);
+
+    // Flipping the sign bit makes the unsigned sort order negative deltas first
+    for (uint16_t i = 0; i < count; i++)
+    {
+      values[i] = (uint32_t)samples[i].heapDelta ^ 0x80000000u;
+    }
+    int32_t medianHeap = (int32_t)(percentile(values, count, 50) ^ 0x80000000u);
+
+    LOG_INFO("bench %s %s: min %.1f median %.1f p99 %.1f ms, %u failed", name, mode, minUs / 1000.0,
+             medianUs / 1000.0, p99Us / 1000.0, (unsigned)failed);
+    LOG_INFO("bench %s %s: %u body bytes, heap %+ld, TLS %.0f%% DNS %.0f%%", name, mode, (unsigned)medianBytes,
+             (long)medianHeap, wallTotal ? 100.0 * tlsTotal / wallTotal : 0.0,
+             wallTotal ? 100.0 * dnsTotal / wallTotal : 0.0);
+  }
+
+public:
+  static void run(Timer **timers, uint8_t count, JsonArena &arena, uint16_t iterations)
+  {
+    iterations = std::max<uint16_t>(1, std::min<uint16_t>(iterations, POLL_BENCH_MAX_ITERATIONS));
+    size_t freeAtStart = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    LOG_INFO("bench: %u polls per case, %u bytes heap free", (unsigned)iterations, (unsigned)freeAtStart);
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+      if (!timers[i]->isPollable())
+      {
+        continue;
+      }
+      PollingTimer *timer = static_cast<PollingTimer *>(timers[i]);
+      if (quotaShort(timer, 2u * iterations + 1))
+      {
+        LOG_WARN("bench %s: skipped, %ld requests left", timer->getDisplayName(), (long)timer->getQuotaRemaining());
+        continue;
+      }
+      runCase(timer, arena, iterations, true);
+      runCase(timer, arena, iterations, false);
+    }
+
+    // With every connection closed again, anything still missing has leaked
+    connectionPool.closeAll();
+    LOG_INFO("bench: done, heap %+ld since start",
+             (long)((int32_t)freeAtStart - (int32_t)heap_caps_get_free_size(MALLOC_CAP_INTERNAL)));
+  }
+};
+
+#endif
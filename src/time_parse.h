@@ -0,0 +1,200 @@
+#ifndef TIME_PARSE_H
+#define TIME_PARSE_H
+
+#include <stdint.h>
+
+// Fixed-format UTC timestamp parsing without strptime/mktime. mktime goes
+// through the TZ rules and normalises every field, which is slow and would
+// silently shift results if the device ever ran with a non-UTC offset. These
+// compute the epoch arithmetically and are constexpr, so the checks at the
+// bottom of this file run at compile time.
+
+// Days since 1970-01-01 for a proleptic Gregorian date (Howard Hinnant's days_from_civil)
+constexpr int64_t daysFromCivil(int64_t year, unsigned month, unsigned day)
+{
+  year -= month <= 2;
+  const int64_t era = (year >= 0 ? year : year - 399) / 400;
+  const unsigned yearOfEra = static_cast<unsigned>(year - era * 400);
+  const unsigned dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+  const unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  return era * 146097 + static_cast<int64_t>(dayOfEra) - 719468;
+}
+
+constexpr unsigned daysInMonth(int64_t year, unsigned month)
+{
+  return month == 2 ? ((year % 4 == 0 && year % 100 != 0) || year % 400 == 0 ? 29 : 28)
+                    : (month == 4 || month == 6 || month == 9 || month == 11 ? 30 : 31);
+}
+
+// Reads exactly count digits and advances text past them
+constexpr bool readDigits(const char *&text, int count, int &value)
+{
+  value = 0;
+  for (int i = 0; i < count; i++)
+  {
+    if (text[i] < '0' || text[i] > '9')
+    {
+      return false;
+    }
+    value = value * 10 + (text[i] - '0');
+  }
+  text += count;
+  return true;
+}
+
+constexpr bool readChar(const char *&text, char expected)
+{
+  if (*text != expected)
+  {
+    return false;
+  }
+  text++;
+  return true;
+}
+
+constexpr bool civilToEpoch(int year, int month, int day, int hour, int minute, int second, int64_t &epoch)
+{
+  if (month < 1 || month > 12 || day < 1 || (unsigned)day > daysInMonth(year, month) ||
+      hour > 23 || minute > 59 || second > 60)
+  {
+    return false;
+  }
+  // A leap second is folded into the one before it
+  epoch = daysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + (second == 60 ? 59 : second);
+  return true;
+}
+
+// "2024-03-01T12:34:56Z", with optional fractional seconds and a "Z",
+// "+HH:MM" or "+HHMM" suffix; a timestamp without one is taken as UTC. The
+// date and time may also be separated by a space, as some APIs do.
+constexpr bool parseIso8601(const char *text, int64_t &epoch)
+{
+  int year = 0, month = 0, day = 0, hour = 0, minute = 0, second = 0;
+  if (!readDigits(text, 4, year) || !readChar(text, '-') || !readDigits(text, 2, month) ||
+      !readChar(text, '-') || !readDigits(text, 2, day))
+  {
+    return false;
+  }
+  if (*text != 'T' && *text != 't' && *text != ' ')
+  {
+    return false;
+  }
+  text++;
+  if (!readDigits(text, 2, hour) || !readChar(text, ':') || !readDigits(text, 2, minute) ||
+      !readChar(text, ':') || !readDigits(text, 2, second))
+  {
+    return false;
+  }
+
+  // Sub-second precision is dropped
+  if (*text == '.' || *text == ',')
+  {
+    text++;
+    if (*text < '0' || *text > '9')
+    {
+      return false;
+    }
+    while (*text >= '0' && *text <= '9')
+    {
+      text++;
+    }
+  }
+
+  int offset = 0;
+  if (*text == 'Z' || *text == 'z')
+  {
+    text++;
+  }
+  else if (*text == '+' || *text == '-')
+  {
+    int sign = *text == '-' ? -1 : 1;
+    int offsetHours = 0, offsetMinutes = 0;
+    text++;
+    if (!readDigits(text, 2, offsetHours))
+    {
+      return false;
+    }
+    readChar(text, ':');
+    if (!readDigits(text, 2, offsetMinutes) || offsetHours > 23 || offsetMinutes > 59)
+    {
+      return false;
+    }
+    offset = sign * (offsetHours * 3600 + offsetMinutes * 60);
+  }
+
+  if (*text != '\0' || !civilToEpoch(year, month, day, hour, minute, second, epoch))
+  {
+    return false;
+  }
+  epoch -= offset;
+  return true;
+}
+
+// IMF-fixdate as sent in Retry-After and Last-Modified: "Sun, 06 Nov 1994 08:49:37 GMT"
+constexpr bool parseHttpDate(const char *text, int64_t &epoch)
+{
+  const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+  int year = 0, month = 0, day = 0, hour = 0, minute = 0, second = 0;
+
+  // The weekday name is redundant
+  for (int i = 0; i < 3; i++)
+  {
+    if (text[i] == '\0')
+    {
+      return false;
+    }
+  }
+  text += 3;
+  if (!readChar(text, ',') || !readChar(text, ' ') || !readDigits(text, 2, day) || !readChar(text, ' '))
+  {
+    return false;
+  }
+  for (int i = 0; i < 12 && month == 0; i++)
+  {
+    if (text[0] == months[i * 3] && text[1] == months[i * 3 + 1] && text[2] == months[i * 3 + 2])
+    {
+      month = i + 1;
+    }
+  }
+  if (month == 0)
+  {
+    return false;
+  }
+  text += 3;
+  if (!readChar(text, ' ') || !readDigits(text, 4, year) || !readChar(text, ' ') ||
+      !readDigits(text, 2, hour) || !readChar(text, ':') || !readDigits(text, 2, minute) ||
+      !readChar(text, ':') || !readDigits(text, 2, second))
+  {
+    return false;
+  }
+  if (!readChar(text, ' ') || !readChar(text, 'G') || !readChar(text, 'M') || !readChar(text, 'T') || *text != '\0')
+  {
+    return false;
+  }
+  return civilToEpoch(year, month, day, hour, minute, second, epoch);
+}
+
+// For constant expressions: the parsed epoch, or fallback if text is malformed
+constexpr int64_t iso8601Or(const char *text, int64_t fallback)
+{
+  int64_t epoch = 0;
+  return parseIso8601(text, epoch) ? epoch : fallback;
+}
+
+constexpr int64_t httpDateOr(const char *text, int64_t fallback)
+{
+  int64_t epoch = 0;
+  return parseHttpDate(text, epoch) ? epoch : fallback;
+}
+
+static_assert(daysFromCivil(1970, 1, 1) == 0, "epoch day");
+static_assert(daysFromCivil(2000, 3, 1) == 11017, "day after a century leap day");
+static_assert(iso8601Or("2024-02-29T23:59:59Z", -1) == 1709251199, "leap day");
+static_assert(iso8601Or("2024-11-20T18:04:05.123456Z", -1) == 1732125845, "fractional seconds");
+static_assert(iso8601Or("2024-11-20T20:04:05+02:00", -1) == 1732125845, "positive offset");
+static_assert(iso8601Or("2024-11-20T13:34:05-0430", -1) == 1732125845, "negative offset without colon");
+static_assert(iso8601Or("2023-02-29T00:00:00Z", -1) == -1, "not a leap year");
+static_assert(iso8601Or("2024-11-20T18:04", -1) == -1, "truncated");
+static_assert(httpDateOr("Sun, 06 Nov 1994 08:49:37 GMT", -1) == 784111777, "IMF-fixdate");
+
+#endif
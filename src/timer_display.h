@@ -0,0 +1,256 @@
+#ifndef TIMER_DISPLAY_H
+#define TIMER_DISPLAY_H
+
+#include <Arduino.h>
+#include <LiquidCrystal_I2C.h>
+#include "alloc_trace.h"
+#include "button_input.h"
+#include "clock_sync.h"
+#include "lcd_framebuffer.h"
+#include "metrics.h"
+#include "timers.h"
+
+// After the last button press, the display stays lit this long in the dark
+#define DISPLAY_AWAKE_MS 30000
+
+// Class to manage timer display and button interaction. Draws through an
+// LcdFramebuffer, so only changed cells go over I2C. Holding the action
+// button switches between the time since each timer's last trigger and the
+// statistics over its trigger history.
+//
+// In a dark room the display goes to sleep once no button has been pressed
+// for DISPLAY_AWAKE_MS: the backlight switches off and nothing is drawn. The
+// first press while asleep only wakes it, so a fumbled press in the dark
+// cannot trigger a timer nobody can see.
+class TimerDisplay
+{
+private:
+  Timer **timers;
+  uint8_t timerCount;
+  uint8_t currentIndex;
+  ButtonInput &buttons;
+  const ClockSync &clock;
+  LcdFramebuffer frame;
+  int16_t lastIndex; // Timer whose name is on screen, -1 before the first draw
+  int32_t lastSeconds;
+  ClockState lastClockState;
+  bool lastHasValue;
+  bool showStats;
+  TriggerHistory::Stats lastStats;
+  LatencyHistogram &lcdWriteTime;
+  bool dark;
+  uint32_t lastPressMs;
+
+public:
+  TimerDisplay(Timer **timerArray, uint8_t count, ButtonInput &buttonInput, const ClockSync &clockSync,
+               LiquidCrystal_I2C &lcdDisplay, LatencyHistogram &lcdWriteHistogram)
+      : timers(timerArray), timerCount(count), currentIndex(0),
+        buttons(buttonInput), clock(clockSync), frame(lcdDisplay),
+        lastIndex(-1), lastSeconds(-1), lastClockState(CLOCK_UNKNOWN), lastHasValue(false),
+        showStats(false), lastStats{}, lcdWriteTime(lcdWriteHistogram), dark(false), lastPressMs(millis()) {}
+
+  // After the timers are rebuilt; shows the first one
+  void setTimers(Timer **timerArray, uint8_t count)
+  {
+    timers = timerArray;
+    timerCount = count;
+    currentIndex = 0;
+    lastIndex = -1;
+  }
+
+  // From the ambient light sensor; the display stays awake until the next
+  // DISPLAY_AWAKE_MS without a press
+  void setDark(bool isDark)
+  {
+    dark = isDark;
+    lastPressMs = millis();
+  }
+
+  bool isAsleep() const
+  {
+    return dark && millis() - lastPressMs >= DISPLAY_AWAKE_MS;
+  }
+
+  // Steady state makes no heap allocations; build with UI_ALLOC_TRACE to check
+  void update(time_t now)
+  {
+    uint32_t allocations = allocTraceCount();
+
+    handleButtons(now);
+    bool asleep = isAsleep();
+    frame.setBacklight(!asleep);
+    if (!asleep)
+    {
+      updateDisplay(now);
+    }
+
+    allocTraceReport("TimerDisplay::update", allocTraceCount() - allocations);
+  }
+
+  // Apply every debounced press queued since the last update
+  void handleButtons(time_t currentTime)
+  {
+    ButtonId button;
+    while (buttons.nextPress(button))
+    {
+      bool asleep = isAsleep();
+      lastPressMs = millis();
+      if (asleep)
+      {
+        continue;
+      }
+
+      switch (button)
+      {
+      case BUTTON_ACTION:
+        timers[currentIndex]->handleButtonPress(currentTime);
+        break;
+      case BUTTON_ACTION_HOLD:
+        showStats = !showStats;
+        lastIndex = -1;
+        break;
+      case BUTTON_DOWN:
+        nextTimer();
+        break;
+      case BUTTON_UP:
+        previousTimer();
+        break;
+      }
+    }
+  }
+
+  void nextTimer()
+  {
+    currentIndex = (currentIndex + 1) % timerCount;
+  }
+
+  void previousTimer()
+  {
+    currentIndex = (currentIndex + timerCount - 1) % timerCount;
+  }
+
+  // Get currently selected timer
+  Timer *getCurrentTimer() const
+  {
+    return timers[currentIndex];
+  }
+
+private:
+  // Largest unit that keeps the value under ten, e.g. "45s", "3.2h", "12d"
+  static void formatSpan(char *dest, size_t size, uint32_t seconds)
+  {
+    static const uint32_t units[] = {1, 60, 3600, 86400};
+    static const char names[] = "smhd";
+    uint8_t unit = 3;
+    while (unit > 0 && seconds < units[unit])
+    {
+      unit--;
+    }
+    uint32_t tenths = (uint64_t)seconds * 10 / units[unit];
+    if (unit > 0 && tenths < 100)
+    {
+      snprintf(dest, size, "%u.%u%c", (unsigned)(tenths / 10), (unsigned)(tenths % 10), names[unit]);
+    }
+    else
+    {
+      snprintf(dest, size, "%u%c", (unsigned)(tenths / 10), names[unit]);
+    }
+  }
+
+  // Redraws only when an aggregate moves; stats() never walks the history
+  void updateStats(time_t now)
+  {
+    Timer *current = getCurrentTimer();
+    TriggerHistory::Stats stats = current->getHistory().stats(now);
+    if (currentIndex == lastIndex && memcmp(&stats, &lastStats, sizeof(stats)) == 0)
+    {
+      return;
+    }
+
+    // The name stays on row 0 so paging through timers shows whose stats these are;
+    // the current and best streak in days cut into its end, e.g. "Last drank  5/9d"
+    frame.clear();
+    frame.print(0, 0, current->getDisplayName());
+    if (stats.events < 2)
+    {
+      frame.printRight(1, "no history");
+    }
+    else
+    {
+      char text[LCD_COLS + 1];
+      char span[8];
+      snprintf(text, sizeof(text), " %u/%ud", (unsigned)stats.streak, (unsigned)stats.bestStreak);
+      frame.printRight(0, text);
+      formatSpan(span, sizeof(span), stats.meanGap);
+      snprintf(text, sizeof(text), "avg %s", span);
+      frame.print(0, 1, text);
+      formatSpan(span, sizeof(span), stats.maxGap);
+      snprintf(text, sizeof(text), "max %s", span);
+      frame.printRight(1, text);
+    }
+    uint32_t start = micros();
+    if (frame.flush() > 0)
+    {
+      lcdWriteTime.record(micros() - start);
+    }
+
+    lastIndex = currentIndex;
+    lastStats = stats;
+  }
+
+  void updateDisplay(time_t now)
+  {
+    if (showStats)
+    {
+      updateStats(now);
+      return;
+    }
+
+    Timer *current = getCurrentTimer();
+    int32_t seconds = current->timeSince(now);
+    ClockState clockState = clock.getState();
+    bool hasValue = current->hasValue();
+
+    // The first result redraws at once, since a completed poll wakes the loop
+    if (currentIndex != lastIndex || seconds != lastSeconds || clockState != lastClockState ||
+        hasValue != lastHasValue)
+    {
+      int hours = seconds / 3600;
+      int minutes = (seconds % 3600) / 60;
+      int secs = seconds % 60;
+
+      // A provisional clock may be behind by the time power was off
+      char timeStr[17];
+      if (clockState == CLOCK_UNKNOWN)
+      {
+        strcpy(timeStr, "--:--:--");
+      }
+      else if (!hasValue)
+      {
+        strcpy(timeStr, "syncing...");
+      }
+      else
+      {
+        snprintf(timeStr, sizeof(timeStr), "%s%02d:%02d:%02d",
+                 clockState == CLOCK_PROVISIONAL ? "~" : "", hours, minutes, secs);
+      }
+
+      // Compose the whole screen; the framebuffer only sends cells that changed
+      frame.clear();
+      frame.print(0, 0, current->getDisplayName());
+      frame.printRight(1, timeStr);
+      uint32_t start = micros();
+      if (frame.flush() > 0)
+      {
+        lcdWriteTime.record(micros() - start);
+      }
+
+      lastIndex = currentIndex;
+      lastSeconds = seconds;
+      lastClockState = clockState;
+      lastHasValue = hasValue;
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,303 @@
+#ifndef TIMER_POOL_H
+#define TIMER_POOL_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <FS.h>
+#include <algorithm>
+#include <freertos/semphr.h>
+#include <new>
+#include <stdexcept>
+#include "lcd_framebuffer.h"
+#include "logger.h"
+#include "timers.h"
+
+#define TIMER_POOL_SIZE 16
+#define TIMER_NAME_SIZE 32 // Including the terminator; the LCD shows the first 16
+#define TIMER_MIN_POLL_INTERVAL 60
+
+// Timers built from a JSON description:
+//
+//   {"timers": [
+//     {"type": "button", "name": "Last drank water"},
+//     {"type": "github", "name": "Last GitHub push", "user": "evjrob", "interval": 300, "max_interval": 3600},
+//     {"type": "bluesky", "name": "Last Bsky post", "handle": "evjrob.bsky.social"},
+//     {"type": "weather", "name": "Last above 0°C", "lat": 49.8954, "lon": -97.1385, "interval": 900}
+//   ]}
+//
+// "interval" is optional. So is "max_interval", which lets a polling timer
+// slow down to that while its history or forecast says nothing is due; the
+// display can then lag by up to that long. Each timer is constructed with placement new into
+// one slot of a static array sized for the largest timer class, so a config
+// of any size up to TIMER_POOL_SIZE makes no heap allocations and rebuilding
+// it in place cannot fragment the heap. Names are unique: the timer store
+// and pushes both identify timers by name. Names go through lcdText(), so
+// a degree sign in the config shows as one on the LCD.
+class TimerPool
+{
+private:
+  static constexpr size_t SLOT_ALIGN = std::max({alignof(ButtonTimer), alignof(GitHubPollingTimer),
+                                                 alignof(BlueskyPollingTimer), alignof(WeatherPollingTimer)});
+  static constexpr size_t SLOT_SIZE =
+      (std::max({sizeof(ButtonTimer), sizeof(GitHubPollingTimer), sizeof(BlueskyPollingTimer),
+                 sizeof(WeatherPollingTimer)}) + SLOT_ALIGN - 1) / SLOT_ALIGN * SLOT_ALIGN;
+
+  alignas(SLOT_ALIGN) uint8_t storage[TIMER_POOL_SIZE][SLOT_SIZE];
+  char names[TIMER_POOL_SIZE][TIMER_NAME_SIZE];
+  Timer *timers[TIMER_POOL_SIZE];
+  uint8_t count;
+  SemaphoreHandle_t mutex;
+
+  Timer *construct(JsonObjectConst entry, void *slot, const char *name, time_t now)
+  {
+    Timer *timer = constructType(entry, slot, name, now);
+    if (timer->isPollable() && !entry["max_interval"].isNull())
+    {
+      static_cast<PollingTimer *>(timer)->setMaxInterval(entry["max_interval"]);
+    }
+    return timer;
+  }
+
+  Timer *constructType(JsonObjectConst entry, void *slot, const char *name, time_t now)
+  {
+    const char *type = entry["type"];
+    if (strcmp(type, "button") == 0)
+    {
+      return new (slot) ButtonTimer(name, now);
+    }
+    if (strcmp(type, "github") == 0)
+    {
+      uint32_t interval = entry["interval"] | GitHubPollingTimer::DEFAULT_POLL_INTERVAL;
+      return new (slot) GitHubPollingTimer(name, entry["user"], interval, now);
+    }
+    if (strcmp(type, "bluesky") == 0)
+    {
+      uint32_t interval = entry["interval"] | BlueskyPollingTimer::DEFAULT_POLL_INTERVAL;
+      return new (slot) BlueskyPollingTimer(name, entry["handle"], interval, now);
+    }
+    uint32_t interval = entry["interval"] | WeatherPollingTimer::DEFAULT_POLL_INTERVAL;
+    return new (slot) WeatherPollingTimer(name, entry["lat"], entry["lon"], interval);
+  }
+
+public:
+  TimerPool() : count(0), mutex(nullptr) {}
+
+  ~TimerPool()
+  {
+    clear();
+  }
+
+  bool begin()
+  {
+    mutex = xSemaphoreCreateMutex();
+    return mutex != nullptr;
+  }
+
+  // Reports the first problem in error; nothing is built from a config that fails
+  static bool validate(const JsonDocument &doc, char *error, size_t size)
+  {
+    JsonArrayConst entries = doc["timers"];
+    if (entries.isNull())
+    {
+      snprintf(error, size, "missing \"timers\" array");
+      return false;
+    }
+    if (entries.size() == 0 || entries.size() > TIMER_POOL_SIZE)
+    {
+      snprintf(error, size, "need 1 to %d timers", TIMER_POOL_SIZE);
+      return false;
+    }
+
+    char seen[TIMER_POOL_SIZE][TIMER_NAME_SIZE];
+    uint8_t index = 0;
+    for (JsonObjectConst entry : entries)
+    {
+      const char *type = entry["type"] | "";
+      const char *name = entry["name"] | "";
+      bool polling = strcmp(type, "button") != 0;
+      const char *problem = nullptr;
+      uint32_t interval = entry["interval"] | (uint32_t)TIMER_MIN_POLL_INTERVAL;
+
+      if (strcmp(type, "button") != 0 && strcmp(type, "github") != 0 && strcmp(type, "bluesky") != 0 &&
+          strcmp(type, "weather") != 0)
+      {
+        problem = "unknown type";
+      }
+      else if (name[0] == '\0' || strlen(name) >= TIMER_NAME_SIZE)
+      {
+        problem = "name missing or too long";
+      }
+      else if (strcmp(type, "github") == 0 && !entry["user"].is<const char *>())
+      {
+        problem = "missing user";
+      }
+      else if (strcmp(type, "bluesky") == 0 && !entry["handle"].is<const char *>())
+      {
+        problem = "missing handle";
+      }
+      else if (strcmp(type, "weather") == 0 && (!entry["lat"].is<float>() || !entry["lon"].is<float>()))
+      {
+        problem = "missing lat or lon";
+      }
+      else if (polling && !entry["interval"].isNull() &&
+               (!entry["interval"].is<uint32_t>() || entry["interval"].as<uint32_t>() < TIMER_MIN_POLL_INTERVAL))
+      {
+        problem = "interval below minimum";
+      }
+      else if (polling && !entry["max_interval"].isNull() &&
+               (!entry["max_interval"].is<uint32_t>() ||
+                entry["max_interval"].as<uint32_t>() < interval))
+      {
+        problem = "max_interval below interval";
+      }
+
+      if (problem == nullptr)
+      {
+        lcdText(seen[index], TIMER_NAME_SIZE, name);
+        for (uint8_t i = 0; i < index && problem == nullptr; i++)
+        {
+          if (strcmp(seen[i], seen[index]) == 0)
+          {
+            problem = "duplicate name";
+          }
+        }
+      }
+
+      if (problem != nullptr)
+      {
+        snprintf(error, size, "timer %u: %s", (unsigned)index, problem);
+        return false;
+      }
+      index++;
+    }
+    return true;
+  }
+
+  // Replaces every timer. Entries whose constructor rejects them are skipped.
+  bool build(const JsonDocument &doc)
+  {
+    char error[64];
+    if (!validate(doc, error, sizeof(error)))
+    {
+      LOG_ERROR("Timer config: %s", error);
+      return false;
+    }
+
+    clear();
+    time_t now = time(nullptr);
+    for (JsonObjectConst entry : doc["timers"].as<JsonArrayConst>())
+    {
+      lcdText(names[count], TIMER_NAME_SIZE, entry["name"]);
+      try
+      {
+        timers[count] = construct(entry, storage[count], names[count], now);
+        count++;
+      }
+      catch (const std::invalid_argument &e)
+      {
+        LOG_ERROR("Timer config: %s skipped, %s", names[count], e.what());
+      }
+    }
+    return count > 0;
+  }
+
+  bool load(const char *json)
+  {
+    JsonDocument doc;
+    DeserializationError error = deserializeJson(doc, json);
+    if (error)
+    {
+      LOG_ERROR("Timer config: %s", error.c_str());
+      return false;
+    }
+    return build(doc);
+  }
+
+  bool load(fs::FS &fs, const char *path)
+  {
+    File file = fs.open(path, "r");
+    if (!file)
+    {
+      return false;
+    }
+
+    JsonDocument doc;
+    DeserializationError error = deserializeJson(doc, file);
+    file.close();
+    if (error)
+    {
+      LOG_ERROR("Timer config %s: %s", path, error.c_str());
+      return false;
+    }
+    return build(doc);
+  }
+
+  void clear()
+  {
+    for (uint8_t i = 0; i < count; i++)
+    {
+      timers[i]->~Timer();
+    }
+    count = 0;
+  }
+
+  // Hold the lock while using timers from any task but the one that rebuilds the pool
+  void lock()
+  {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+  }
+
+  void unlock()
+  {
+    xSemaphoreGive(mutex);
+  }
+
+  Timer **all()
+  {
+    return timers;
+  }
+
+  // Same shape as TimerTable's, dispatched at run time
+  template <typename F>
+  void forEach(F &&f)
+  {
+    for (uint8_t i = 0; i < count; i++)
+    {
+      f(*timers[i]);
+    }
+  }
+
+  template <typename F>
+  void forEachPolling(F &&f)
+  {
+    for (uint8_t i = 0; i < count; i++)
+    {
+      if (timers[i]->isPollable())
+      {
+        f(*static_cast<PollingTimer *>(timers[i]));
+      }
+    }
+  }
+
+  uint8_t size() const
+  {
+    return count;
+  }
+
+  // Takes the name as written in the config
+  Timer *find(const char *name) const
+  {
+    char display[TIMER_NAME_SIZE];
+    lcdText(display, sizeof(display), name);
+    for (uint8_t i = 0; i < count; i++)
+    {
+      if (strcmp(timers[i]->getDisplayName(), display) == 0)
+      {
+        return timers[i];
+      }
+    }
+    return nullptr;
+  }
+};
+
+#endif
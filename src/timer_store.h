@@ -0,0 +1,159 @@
+#ifndef TIMER_STORE_H
+#define TIMER_STORE_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "logger.h"
+#include "trigger_history.h"
+
+#define TIMER_STORE_NAMESPACE "timers"
+// Bump whenever TimerState changes layout; older snapshots are then ignored
+#define TIMER_STATE_VERSION 4
+
+#define TIMER_STATE_ETAG_SIZE 96
+#define TIMER_STATE_LAST_MODIFIED_SIZE 32
+#define TIMER_STATE_DID_SIZE 64
+#define TIMER_STATE_PDS_URL_SIZE 96
+
+// Everything a timer needs to show correct values straight after boot
+struct TimerState
+{
+  uint8_t version;
+  int64_t lastTriggerTime;
+  int64_t lastPollTime; // 0 when the timer has never polled
+  char etag[TIMER_STATE_ETAG_SIZE];
+  char lastModified[TIMER_STATE_LAST_MODIFIED_SIZE];
+
+  // Provider-specific extras, selected by the timer that wrote the snapshot
+  union
+  {
+    struct
+    {
+      int64_t historyCoveredUntil;
+      float currentTemp; // The reading the saved validators stand for
+    } weather;
+    struct
+    {
+      char did[TIMER_STATE_DID_SIZE];        // Empty when the handle is unresolved
+      char pdsUrl[TIMER_STATE_PDS_URL_SIZE]; // Where that account's repo is hosted
+    } bluesky;
+  } provider;
+};
+
+// NVS-backed snapshots, one blob per timer keyed by a hash of its display
+// name so reordering timers does not mix up their state. Writes are skipped
+// when the blob is byte-identical to the last one written for that key.
+// Trigger histories sit beside the snapshots under a second key per timer,
+// since their encoding varies in length.
+class TimerStore
+{
+private:
+  Preferences prefs;
+  bool opened;
+
+  static void keyFor(const char *name, char *key, size_t size, char prefix = 't')
+  {
+    // FNV-1a; NVS keys are limited to 15 characters
+    uint32_t hash = 2166136261u;
+    for (const char *c = name; *c != '\0'; c++)
+    {
+      hash = (hash ^ (uint8_t)*c) * 16777619u;
+    }
+    snprintf(key, size, "%c%08lx", prefix, (unsigned long)hash);
+  }
+
+public:
+  TimerStore() : opened(false) {}
+
+  bool begin()
+  {
+    opened = prefs.begin(TIMER_STORE_NAMESPACE, false);
+    if (!opened)
+    {
+      LOG_ERROR("Failed to open timer store");
+    }
+    return opened;
+  }
+
+  bool load(const char *name, TimerState &state)
+  {
+    if (!opened)
+    {
+      return false;
+    }
+
+    char key[16];
+    keyFor(name, key, sizeof(key));
+    if (prefs.getBytesLength(key) != sizeof(TimerState))
+    {
+      return false;
+    }
+    return prefs.getBytes(key, &state, sizeof(state)) == sizeof(state) &&
+           state.version == TIMER_STATE_VERSION;
+  }
+
+  // Returns true only if flash was actually written
+  bool save(const char *name, const TimerState &state)
+  {
+    if (!opened)
+    {
+      return false;
+    }
+
+    char key[16];
+    keyFor(name, key, sizeof(key));
+
+    TimerState stored;
+    if (prefs.getBytesLength(key) == sizeof(stored) &&
+        prefs.getBytes(key, &stored, sizeof(stored)) == sizeof(stored) &&
+        memcmp(&stored, &state, sizeof(state)) == 0)
+    {
+      return false;
+    }
+    return prefs.putBytes(key, &state, sizeof(state)) == sizeof(state);
+  }
+
+  bool loadHistory(const char *name, TriggerHistory &history)
+  {
+    if (!opened)
+    {
+      return false;
+    }
+
+    char key[16];
+    keyFor(name, key, sizeof(key), 'h');
+    uint8_t data[TRIGGER_HISTORY_ENCODED_MAX];
+    size_t length = prefs.getBytesLength(key);
+    if (length == 0 || length > sizeof(data) || prefs.getBytes(key, data, length) != length)
+    {
+      return false;
+    }
+    return history.decode(data, length);
+  }
+
+  // Only histories with new triggers are encoded, let alone compared with flash
+  bool saveHistory(const char *name, TriggerHistory &history)
+  {
+    uint8_t data[TRIGGER_HISTORY_ENCODED_MAX];
+    uint32_t revision;
+    size_t length;
+    if (!opened || (length = history.encodeIfChanged(data, revision)) == 0)
+    {
+      return false;
+    }
+
+    char key[16];
+    keyFor(name, key, sizeof(key), 'h');
+    uint8_t stored[TRIGGER_HISTORY_ENCODED_MAX];
+    bool same = prefs.getBytesLength(key) == length && prefs.getBytes(key, stored, length) == length &&
+                memcmp(stored, data, length) == 0;
+    if (!same && prefs.putBytes(key, data, length) != length)
+    {
+      return false;
+    }
+    history.markSaved(revision);
+    return !same;
+  }
+};
+
+#endif
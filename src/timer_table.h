@@ -0,0 +1,134 @@
+#ifndef TIMER_TABLE_H
+#define TIMER_TABLE_H
+
+#include <Arduino.h>
+#include <type_traits>
+#include "lcd_framebuffer.h"
+#include "timers.h"
+
+// A timer set fixed at build time, for firmware that does not need a config
+// file. The timers live in one static object, laid out back to back like a
+// tuple, and each is built in place from a lambda returning it:
+//
+//   TimerTable<ButtonTimer, GitHubPollingTimer> timers(
+//       [] { return ButtonTimer("Last drank water"); },
+//       [] { return GitHubPollingTimer("Last GitHub push", "evjrob", 300); });
+//
+// forEach() and forEachPolling() expand to one call per timer on its
+// concrete type, so calls resolve at compile time and a provider that is
+// not listed is never compiled in. all() still gives the Timer pointers the
+// scheduler, display and store take. It has the same interface as TimerPool
+// apart from loading, so main.cpp can use either.
+
+// Head first, then the rest, so the timers sit in declaration order
+template <typename... Timers>
+struct TimerStorage
+{
+  TimerStorage() {}
+  void collect(Timer **) {}
+
+  template <typename F>
+  void forEach(F &&) {}
+
+  template <typename F>
+  void forEachPolling(F &&) {}
+};
+
+template <typename Head, typename... Tail>
+struct TimerStorage<Head, Tail...>
+{
+  static_assert(std::is_base_of<Timer, Head>::value, "TimerTable holds timers");
+  // Without final, a call through Head& could still go through the vtable
+  static_assert(std::is_final<Head>::value, "Timers in a TimerTable should be final");
+
+  Head head;
+  TimerStorage<Tail...> tail;
+
+  // Guaranteed copy elision builds each timer in its slot, atomics and all
+  template <typename Make, typename... MakeTail>
+  TimerStorage(Make make, MakeTail... makeTail) : head(make()), tail(makeTail...) {}
+
+  void collect(Timer **out)
+  {
+    out[0] = &head;
+    tail.collect(out + 1);
+  }
+
+  template <typename F>
+  void forEach(F &&f)
+  {
+    f(head);
+    tail.forEach(f);
+  }
+
+  template <typename F>
+  void forEachPolling(F &&f)
+  {
+    if constexpr (std::is_base_of<PollingTimer, Head>::value)
+    {
+      f(head);
+    }
+    tail.forEachPolling(f);
+  }
+};
+
+template <typename... Timers>
+class TimerTable
+{
+  static_assert(sizeof...(Timers) > 0, "TimerTable needs at least one timer");
+
+private:
+  TimerStorage<Timers...> storage;
+  Timer *pointers[sizeof...(Timers)];
+
+public:
+  template <typename... Makes>
+  explicit TimerTable(Makes... makes) : storage(makes...)
+  {
+    static_assert(sizeof...(Makes) == sizeof...(Timers), "One lambda per timer");
+    storage.collect(pointers);
+  }
+
+  template <typename F>
+  void forEach(F &&f)
+  {
+    storage.forEach(f);
+  }
+
+  template <typename F>
+  void forEachPolling(F &&f)
+  {
+    storage.forEachPolling(f);
+  }
+
+  Timer **all()
+  {
+    return pointers;
+  }
+
+  constexpr uint8_t size() const
+  {
+    return sizeof...(Timers);
+  }
+
+  // Takes the name as a client would write it, like TimerPool::find()
+  Timer *find(const char *name) const
+  {
+    char display[LCD_COLS * 2 + 1];
+    lcdText(display, sizeof(display), name);
+    for (Timer *timer : pointers)
+    {
+      if (strcmp(timer->getDisplayName(), display) == 0)
+      {
+        return timer;
+      }
+    }
+    return nullptr;
+  }
+
+  // Never rebuilt, so there is nothing to guard
+  void lock() {}
+  void unlock() {}
+};
+
+#endif
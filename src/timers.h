@@ -0,0 +1,1261 @@
+#ifndef TIMERS_H
+#define TIMERS_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <WiFi.h>
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <time.h>
+#include "connection_pool.h"
+#include "json_arena.h"
+#include "logger.h"
+#include "metrics.h"
+#include "time_parse.h"
+#include "timer_store.h"
+#include "trigger_history.h"
+
+// Failed polls back off from the retry interval, doubling up to the maximum
+#define POLL_RETRY_INTERVAL 30
+#define POLL_BACKOFF_MAX (60 * 60)
+// Units expected to share one API identity; each spends only its share of the
+// quota the server reports as remaining
+#define RATE_LIMIT_SHARED_UNITS 4
+// While pushes keep arriving, polling only reconciles anything a push missed
+#define PUSH_ACTIVE_WINDOW (6 * 60 * 60)
+#define PUSH_RECONCILE_INTERVAL (60 * 60)
+// Adaptive timers poll about this many times over the gap they expect before
+// the next event, once their history holds enough triggers to go on
+#define ADAPTIVE_POLLS_PER_GAP 8
+#define ADAPTIVE_MIN_EVENTS 4
+// With this much history, an hour of day that has never seen a trigger polls half as often
+#define ADAPTIVE_QUIET_MIN_EVENTS 12
+
+class Timer
+{
+protected:
+  const char *name;
+  // Written by the network task, read by the UI task
+  std::atomic<time_t> lastTriggerTime;
+  TriggerHistory history;
+
+public:
+  Timer(const char *displayName,
+        time_t initialTime = time(nullptr))
+      : name(displayName), lastTriggerTime(initialTime) {}
+
+  virtual ~Timer() {}
+
+  int32_t timeSince(time_t currentTime) const
+  {
+    return difftime(currentTime, lastTriggerTime.load());
+  }
+
+  virtual void trigger(time_t triggerTime)
+  {
+    lastTriggerTime.store(triggerTime);
+    if (keepsHistory())
+    {
+      history.record(triggerTime);
+    }
+  }
+
+  // Both trigger() and onPush() record into the history unless this is false
+  virtual bool keepsHistory() const { return true; }
+
+  time_t getLastTriggerTime() const
+  {
+    return lastTriggerTime.load();
+  }
+
+  const char *getDisplayName() const
+  {
+    return name;
+  }
+
+  TriggerHistory &getHistory()
+  {
+    return history;
+  }
+
+  const TriggerHistory &getHistory() const
+  {
+    return history;
+  }
+
+  virtual bool handleButtonPress(time_t currentTime) = 0;
+
+  // Snapshot for the timer store; subclasses extend with their own state
+  virtual void saveState(TimerState &state) const
+  {
+    state.lastTriggerTime = lastTriggerTime.load();
+  }
+
+  virtual void restoreState(const TimerState &state)
+  {
+    lastTriggerTime.store(state.lastTriggerTime);
+  }
+
+  // An event reported by a relay; out-of-order pushes never move the time back
+  virtual void onPush(time_t eventTime)
+  {
+    time_t previous = lastTriggerTime.load();
+    while (eventTime > previous && !lastTriggerTime.compare_exchange_weak(previous, eventTime))
+    {
+    }
+    if (keepsHistory())
+    {
+      history.record(eventTime);
+    }
+  }
+
+  // The clock was just corrected by delta; shift times taken on the old clock
+  virtual void reanchor(time_t since, int32_t delta)
+  {
+    if (lastTriggerTime.load() >= since)
+    {
+      lastTriggerTime.store(lastTriggerTime.load() + delta);
+    }
+    history.reanchor(since, delta);
+  }
+
+  // False until there is a real trigger time to show, so the display can put
+  // up a placeholder instead of the time since boot
+  virtual bool hasValue() const { return true; }
+
+  // Add a virtual method to check if timer is pollable
+  virtual bool isPollable() const { return false; }
+  virtual bool checkPoll(time_t currentTime) { return false; }
+};
+
+class ButtonTimer final : public Timer
+{
+public:
+  ButtonTimer(const char *displayName,
+              time_t initialTime = time(nullptr))
+      : Timer(displayName, initialTime) {}
+
+  bool handleButtonPress(time_t currentTime) override
+  {
+    trigger(currentTime);
+    return true;
+  }
+};
+
+class PollingTimer;
+class PollBench;
+
+// Provided by the application: main.cpp on the device, the bench natively.
+// The pool holds shared keep-alive connections, used only from the network
+// task, and queuePoll() hands a timer to whatever runs its polls.
+extern ConnectionPool connectionPool;
+bool queuePoll(PollingTimer *timer);
+
+// Network cost of the most recent request, kept for the on-device benchmark
+struct PollCost
+{
+  bool openedConnection;
+  uint32_t dnsUs;
+  uint32_t tlsUs;
+  size_t bodyBytes;
+};
+
+class PollingTimer : public Timer
+{
+private:
+  friend class PollBench; // Runs pollImpl() directly, outside the schedule
+
+  std::atomic<time_t> lastPollTime;
+  uint32_t pollingInterval;
+  uint32_t maxInterval; // Above pollingInterval only for adaptive timers
+  std::atomic<bool> pollInFlight;
+
+  // Written by the network task after each response, read by the scheduler
+  std::atomic<uint32_t> budgetInterval; // pollingInterval stretched to fit the remaining quota
+  std::atomic<uint32_t> learnedInterval; // Between pollingInterval and maxInterval
+  std::atomic<time_t> notBefore;        // From Retry-After or an exhausted quota; 0 if none
+  std::atomic<uint8_t> failures;        // Consecutive failed polls
+  std::atomic<time_t> retryAt;
+  std::atomic<time_t> lastPushTime;     // 0 if no push has arrived
+  std::atomic<int32_t> quotaRemaining;  // From the last reply's rate-limit headers; -1 if unknown
+  PollPhaseMetrics phases;
+  PollCost lastCost;                    // Network task only
+
+public:
+  PollingTimer(const char *displayName,
+               uint32_t interval,
+               time_t initialTime = time(nullptr))
+      : Timer(displayName, initialTime),
+        lastPollTime(0), // Never polled, so the first poll is due immediately
+        pollingInterval(interval),
+        maxInterval(interval),
+        pollInFlight(false),
+        budgetInterval(interval),
+        learnedInterval(interval),
+        notBefore(0),
+        failures(0),
+        retryAt(0),
+        lastPushTime(0),
+        quotaRemaining(-1),
+        lastCost{false, 0, 0, 0}
+  {
+    clearValidators();
+  }
+
+  bool shouldPoll(time_t currentTime) const
+  {
+    return currentTime >= nextPollTime();
+  }
+
+  // Manual refresh is queued for the network task rather than run inline
+  bool handleButtonPress(time_t currentTime) override
+  {
+    return queuePoll(this);
+  }
+
+  // Claims the in-flight slot so the same timer is never queued twice
+  bool beginPoll()
+  {
+    return !pollInFlight.exchange(true);
+  }
+
+  void endPoll()
+  {
+    pollInFlight.store(false);
+  }
+
+  bool isPollInFlight() const
+  {
+    return pollInFlight.load();
+  }
+
+  time_t getLastPollTime() const
+  {
+    return lastPollTime.load();
+  }
+
+  uint32_t getPollingInterval() const
+  {
+    return pollingInterval;
+  }
+
+  // Lets the interval stretch up to maxSeconds while nothing is expected to
+  // change, as judged by suggestInterval(). The configured interval stays the
+  // minimum. Call before the first poll.
+  void setMaxInterval(uint32_t maxSeconds)
+  {
+    maxInterval = std::max(maxSeconds, pollingInterval);
+  }
+
+  bool isAdaptive() const
+  {
+    return maxInterval > pollingInterval;
+  }
+
+  // Backs off after failures and never goes earlier than the server allows
+  time_t nextPollTime() const
+  {
+    time_t due = failures.load() > 0 ? retryAt.load() : lastPollTime.load() + currentInterval();
+    return std::max(due, notBefore.load());
+  }
+
+  uint32_t currentInterval() const
+  {
+    uint32_t interval = std::max(budgetInterval.load(), learnedInterval.load());
+    time_t pushed = lastPushTime.load();
+    if (pushed != 0 && time(nullptr) - pushed < PUSH_ACTIVE_WINDOW)
+    {
+      interval = std::max<uint32_t>(interval, PUSH_RECONCILE_INTERVAL);
+    }
+    return interval;
+  }
+
+  void onPush(time_t eventTime) override
+  {
+    Timer::onPush(eventTime);
+    lastPushTime.store(time(nullptr));
+  }
+
+  // Drops the failure backoff, e.g. once the network is back
+  void clearBackoff()
+  {
+    failures.store(0);
+  }
+
+  // Documents built while polling come from arena, which the caller resets afterwards
+  virtual bool poll(JsonArena &arena)
+  {
+    bool success = pollImpl(arena);
+    time_t now = time(nullptr);
+    if (success)
+    {
+      lastPollTime = now;
+      failures.store(0);
+      if (isAdaptive())
+      {
+        learnedInterval.store(std::min(std::max(suggestInterval(now), pollingInterval), maxInterval));
+      }
+    }
+    else
+    {
+      scheduleRetry(now);
+    }
+    return success;
+  }
+
+  // Override to identify as pollable
+  bool isPollable() const override { return true; }
+
+  // A restored snapshot counts, since it carries the last poll time
+  bool hasValue() const override
+  {
+    return lastPollTime.load() != 0 || lastPushTime.load() != 0;
+  }
+
+  const PollPhaseMetrics &getPhaseMetrics() const
+  {
+    return phases;
+  }
+
+  const PollCost &getLastPollCost() const
+  {
+    return lastCost;
+  }
+
+  // Requests the server last said were left in its window, -1 if it never said
+  int32_t getQuotaRemaining() const
+  {
+    return quotaRemaining.load();
+  }
+
+  // Registers the hosts the next poll will use, for pre-resolution. Call only
+  // while no poll of this timer is in flight.
+  virtual void addHosts(DnsCache &dns) const = 0;
+
+  void saveState(TimerState &state) const override
+  {
+    Timer::saveState(state);
+    state.lastPollTime = lastPollTime.load();
+    memcpy(state.etag, etag, sizeof(state.etag));
+    memcpy(state.lastModified, lastModified, sizeof(state.lastModified));
+  }
+
+  // Polls only run on a synced clock and trigger times come from the server,
+  // so only the placeholder of a timer that has never polled is local
+  void reanchor(time_t since, int32_t delta) override
+  {
+    if (lastPollTime.load() == 0)
+    {
+      Timer::reanchor(since, delta);
+    }
+  }
+
+  void restoreState(const TimerState &state) override
+  {
+    Timer::restoreState(state);
+    lastPollTime.store(state.lastPollTime);
+    memcpy(etag, state.etag, sizeof(etag));
+    memcpy(lastModified, state.lastModified, sizeof(lastModified));
+    etag[sizeof(etag) - 1] = '\0';
+    lastModified[sizeof(lastModified) - 1] = '\0';
+  }
+
+  // Override to check and queue polling if needed
+  bool checkPoll(time_t currentTime) override
+  {
+    if (shouldPoll(currentTime))
+    {
+      return queuePoll(this);
+    }
+    return false;
+  }
+
+protected:
+  static const size_t MAX_ETAG_LENGTH = TIMER_STATE_ETAG_SIZE - 1;
+  static const size_t MAX_LAST_MODIFIED_LENGTH = TIMER_STATE_LAST_MODIFIED_SIZE - 1; // "Wed, 21 Oct 2015 07:28:00 GMT"
+
+  // Cache validators from the last response that was fully processed
+  char etag[MAX_ETAG_LENGTH + 1];
+  char lastModified[MAX_LAST_MODIFIED_LENGTH + 1];
+
+  virtual bool pollImpl(JsonArena &arena) = 0;
+
+  // The interval an adaptive timer should poll at next, clamped by the
+  // caller. From the trigger history: a fraction of the typical gap between
+  // events, or of the time since the last one if that is shorter, so polls
+  // come quickly after activity and ease off as things go quiet. Hours of
+  // the day that have never seen a trigger count as quiet. Runs on the
+  // network task after each successful poll.
+  virtual uint32_t suggestInterval(time_t now) const
+  {
+    const TriggerHistory &events = getHistory();
+    TriggerHistory::Stats stats = events.stats(now);
+    if (stats.events < ADAPTIVE_MIN_EVENTS)
+    {
+      return pollingInterval;
+    }
+
+    uint32_t since = std::max<time_t>(0, now - getLastTriggerTime());
+    uint32_t interval = std::min(since, stats.recentGap) / ADAPTIVE_POLLS_PER_GAP;
+
+    // UTC hours are fine here; only the repetition of the day matters
+    if (events.size() >= ADAPTIVE_QUIET_MIN_EVENTS)
+    {
+      uint8_t hour = (now / 3600) % 24;
+      bool seen = false;
+      for (uint8_t i = 0; i < events.size() && !seen; i++)
+      {
+        uint8_t eventHour = (events.at(i) / 3600) % 24;
+        uint8_t distance = (eventHour + 24 - hour) % 24;
+        seen = distance <= 1 || distance == 23;
+      }
+      if (!seen)
+      {
+        interval *= 2;
+      }
+    }
+    return interval;
+  }
+
+  // Failed polls in a row before the one in progress
+  uint8_t consecutiveFailures() const
+  {
+    return failures.load();
+  }
+
+  // Sends GET, with If-None-Match/If-Modified-Since when validators are cached
+  // and useValidators is set, and records the rate-limit headers of the reply.
+  // A 304 reply means the last result still holds and there is no body to parse.
+  int sendGet(PooledRequest &http, bool useValidators = true)
+  {
+    if (useValidators && etag[0] != '\0')
+    {
+      http.addHeader("If-None-Match", etag);
+    }
+    if (useValidators && lastModified[0] != '\0')
+    {
+      http.addHeader("If-Modified-Since", lastModified);
+    }
+
+    int httpCode = http.GET();
+    lastCost = {http.openedConnection(), http.dnsMicros(), http.tlsMicros(), 0};
+    if (http.openedConnection())
+    {
+      phases.dns.record(http.dnsMicros());
+      phases.tls.record(http.tlsMicros());
+    }
+    if (httpCode > 0)
+    {
+      phases.firstByte.record(http.firstByteMicros());
+      noteRateLimit(http, time(nullptr));
+    }
+    return httpCode;
+  }
+
+  // Parses the response body into doc, timing socket waits apart from parsing
+  DeserializationError parseBody(PooledRequest &http, JsonDocument &doc, const JsonDocument &filter)
+  {
+    uint32_t start = micros();
+    uint32_t waitedBefore = http.bodyWaitMicros();
+    DeserializationError error = deserializeJson(doc, http.getStream(), DeserializationOption::Filter(filter));
+    uint32_t waited = http.bodyWaitMicros() - waitedBefore;
+    lastCost.bodyBytes = http.bodyBytes();
+    phases.download.record(waited);
+    phases.parse.record(micros() - start - waited);
+    return error;
+  }
+
+  // Call only once the body has been applied, otherwise a later 304 would
+  // hide data that was never seen
+  void storeValidators(PooledRequest &http)
+  {
+    copyValidator(etag, sizeof(etag), http.header("ETag"));
+    copyValidator(lastModified, sizeof(lastModified), http.header("Last-Modified"));
+  }
+
+  void clearValidators()
+  {
+    etag[0] = '\0';
+    lastModified[0] = '\0';
+  }
+
+private:
+  // Equal jitter: at least half the backoff, so retries stay spread out while
+  // units that failed together drift apart
+  void scheduleRetry(time_t now)
+  {
+    uint8_t attempt = failures.load();
+    uint32_t delay = std::min<uint32_t>(POLL_RETRY_INTERVAL, pollingInterval) << std::min<uint8_t>(attempt, 7);
+    delay = std::min<uint32_t>(delay, POLL_BACKOFF_MAX);
+    delay = delay / 2 + esp_random() % (delay / 2 + 1);
+
+    retryAt.store(now + delay);
+    failures.store(attempt < UINT8_MAX ? attempt + 1 : attempt);
+  }
+
+  // GitHub sends X-RateLimit-*, Bluesky the unprefixed draft names
+  static bool quotaHeader(PooledRequest &http, const char *name, long &value)
+  {
+    char prefixed[32];
+    snprintf(prefixed, sizeof(prefixed), "X-%s", name);
+    String text = http.header(prefixed);
+    if (text.length() == 0)
+    {
+      text = http.header(name);
+    }
+
+    char *end;
+    value = strtol(text.c_str(), &end, 10);
+    return text.length() > 0 && *end == '\0';
+  }
+
+  // Delta seconds or an HTTP date; 0 if absent or unreadable
+  static time_t retryAfter(PooledRequest &http, time_t now)
+  {
+    String text = http.header("Retry-After");
+    if (text.length() == 0)
+    {
+      return 0;
+    }
+
+    char *end;
+    long seconds = strtol(text.c_str(), &end, 10);
+    if (*end == '\0')
+    {
+      return now + seconds;
+    }
+
+    int64_t epoch;
+    return parseHttpDate(text.c_str(), epoch) ? (time_t)epoch : 0;
+  }
+
+  void noteRateLimit(PooledRequest &http, time_t now)
+  {
+    time_t wait = retryAfter(http, now);
+    uint32_t interval = pollingInterval;
+
+    long remaining, reset;
+    if (quotaHeader(http, "RateLimit-Remaining", remaining) && quotaHeader(http, "RateLimit-Reset", reset))
+    {
+      // Reset is an epoch from both providers, but the draft standard sends seconds from now
+      time_t resetTime = reset < 1000000000L ? now + reset : (time_t)reset;
+      quotaRemaining.store((int32_t)std::max<long>(remaining, 0));
+
+      if (remaining <= 0)
+      {
+        wait = std::max(wait, resetTime);
+      }
+      else if (resetTime > now)
+      {
+        interval = std::max<uint32_t>(interval, (resetTime - now) * RATE_LIMIT_SHARED_UNITS / remaining);
+      }
+
+      if (interval != budgetInterval.load())
+      {
+        LOG_WARN("%s: %ld requests left, polling every %u s", getDisplayName(), remaining, (unsigned)interval);
+      }
+    }
+
+    if (wait > now)
+    {
+      LOG_WARN("%s: server asked to wait %ld s", getDisplayName(), (long)(wait - now));
+    }
+    budgetInterval.store(interval);
+    notBefore.store(wait > now ? wait : 0);
+  }
+
+  static void copyValidator(char *dest, size_t size, const String &value)
+  {
+    // Oversized validators are dropped rather than truncated into a value that never matches
+    if (value.length() >= size)
+    {
+      dest[0] = '\0';
+      return;
+    }
+    memcpy(dest, value.c_str(), value.length() + 1);
+  }
+};
+
+class GitHubPollingTimer final : public PollingTimer
+{
+private:
+  static const size_t MAX_USERNAME_LENGTH = 39;
+  char githubUser[MAX_USERNAME_LENGTH + 1]; // +1 for null terminator
+
+  // Built once; only created_at of the newest event is kept
+  static const JsonDocument &eventFilter()
+  {
+    static const JsonDocument filter = []
+    {
+      JsonDocument doc;
+      doc[0]["created_at"] = true;
+      return doc;
+    }();
+    return filter;
+  }
+
+public:
+  static constexpr uint32_t DEFAULT_POLL_INTERVAL = 300;
+
+  GitHubPollingTimer(const char *displayName,
+                     const char *username,
+                     uint32_t pollInterval = DEFAULT_POLL_INTERVAL,
+                     time_t initialTime = time(nullptr))
+      : PollingTimer(displayName, pollInterval, initialTime)
+  {
+    LOG_DEBUG("Starting GitHub timer constructor");
+
+    // Check username length before copying
+    if (strlen(username) > MAX_USERNAME_LENGTH)
+    {
+      LOG_ERROR("GitHub username exceeds maximum length of 39 characters");
+      throw std::invalid_argument("GitHub username too long");
+    }
+
+    strcpy(githubUser, username);
+  }
+
+  void addHosts(DnsCache &dns) const override
+  {
+    dns.remember("api.github.com");
+  }
+
+protected:
+  bool pollImpl(JsonArena &arena) override
+  {
+    LOG_DEBUG("Starting GitHub poll");
+    if (WiFi.status() != WL_CONNECTED)
+    {
+      LOG_WARN("WiFi not connected");
+      return false;
+    }
+
+    PooledRequest http(connectionPool);
+
+    char url[96];
+    // Only the newest event matters, so skip the default 30-event page
+    snprintf(url, sizeof(url), "https://api.github.com/users/%s/events?per_page=1", githubUser);
+    LOG_DEBUG("Polling URL: %s", url);
+
+    if (!http.begin(url))
+    {
+      LOG_ERROR("HTTP begin failed");
+      return false;
+    }
+
+    http.addHeader("Accept", "application/vnd.github.v3+json");
+    http.addHeader("User-Agent", "ESP32");
+
+    // GitHub does not count 304 replies against the rate limit
+    int httpCode = sendGet(http);
+    LOG_DEBUG("HTTP Response code: %d", httpCode);
+    bool success = httpCode == HTTP_CODE_NOT_MODIFIED;
+
+    if (httpCode == HTTP_CODE_OK)
+    {
+      JsonDocument doc(&arena);
+      DeserializationError error = parseBody(http, doc, eventFilter());
+
+      if (error)
+      {
+        LOG_ERROR("JSON parse error: %s", error.c_str());
+      }
+
+      if (!error && doc[0]["created_at"])
+      {
+        const char *dateStr = doc[0]["created_at"];
+        LOG_DEBUG("Found date string: %s", dateStr);
+        int64_t eventTime;
+        if (parseIso8601(dateStr, eventTime))
+        {
+          time_t currentTime = time(nullptr);
+          LOG_DEBUG("Event time: %ld, Current time: %ld", (long)eventTime, (long)currentTime);
+          trigger(eventTime);
+          storeValidators(http);
+          success = true;
+        }
+      }
+    }
+
+    http.end();
+    return success;
+  }
+};
+
+// Polls the account's own PDS rather than the bsky.social entryway, which
+// would otherwise resolve the handle and proxy the request on every poll.
+// The DID and PDS are looked up once (handle to DID, then the DID document
+// for its #atproto_pds service) and kept with the timer's saved state. A
+// migrated or deleted account makes the old PDS answer 4xx, and a PDS that
+// has gone away fails to connect, so both drop the cache and the next poll
+// resolves again. While resolution keeps failing, polls go through the
+// entryway as before and it is retried hourly.
+class BlueskyPollingTimer final : public PollingTimer
+{
+private:
+  static const size_t MAX_HANDLE_LENGTH = 253;
+  static const size_t MAX_DID_LENGTH = TIMER_STATE_DID_SIZE - 1;
+  static const size_t MAX_PDS_URL_LENGTH = TIMER_STATE_PDS_URL_SIZE - 1;
+  // Transport failures in a row on a cached PDS before it is looked up again
+  static const uint8_t RESOLVE_AFTER_FAILURES = 3;
+  // Polls go through the entryway for this long after resolution fails
+  static const uint32_t RESOLVE_RETRY_INTERVAL = 3600;
+
+  char handle[MAX_HANDLE_LENGTH + 1]; // +1 for null terminator
+  char did[MAX_DID_LENGTH + 1];       // Empty until resolved; network task only
+  char pdsUrl[MAX_PDS_URL_LENGTH + 1];
+  time_t resolveAfter; // Network task only
+
+  static const JsonDocument &recordFilter()
+  {
+    static const JsonDocument filter = []
+    {
+      JsonDocument doc;
+      doc["records"][0]["value"]["createdAt"] = true;
+      return doc;
+    }();
+    return filter;
+  }
+
+  static const JsonDocument &didFilter()
+  {
+    static const JsonDocument filter = []
+    {
+      JsonDocument doc;
+      doc["did"] = true;
+      return doc;
+    }();
+    return filter;
+  }
+
+  static const JsonDocument &serviceFilter()
+  {
+    static const JsonDocument filter = []
+    {
+      JsonDocument doc;
+      doc["service"][0]["id"] = true;
+      doc["service"][0]["type"] = true;
+      doc["service"][0]["serviceEndpoint"] = true;
+      return doc;
+    }();
+    return filter;
+  }
+
+  // GET without validators; true only for a 200 that parsed
+  bool fetchJson(const char *url, JsonDocument &doc, const JsonDocument &filter)
+  {
+    PooledRequest http(connectionPool);
+    if (!http.begin(url))
+    {
+      LOG_ERROR("HTTP begin failed");
+      return false;
+    }
+
+    int httpCode = sendGet(http, false);
+    if (httpCode != HTTP_CODE_OK)
+    {
+      LOG_WARN("%s: %s returned %d", getDisplayName(), url, httpCode);
+      return false;
+    }
+
+    DeserializationError error = parseBody(http, doc, filter);
+    http.end();
+    if (error)
+    {
+      LOG_ERROR("JSON parse error: %s", error.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  bool resolveIdentity(JsonArena &arena)
+  {
+    char resolved[MAX_DID_LENGTH + 1];
+    char url[64 + MAX_HANDLE_LENGTH];
+
+    // A DID may be configured in place of the handle
+    if (strncmp(handle, "did:", 4) == 0)
+    {
+      if (strlen(handle) > MAX_DID_LENGTH)
+      {
+        return false;
+      }
+      strcpy(resolved, handle);
+    }
+    else
+    {
+      snprintf(url, sizeof(url), "https://bsky.social/xrpc/com.atproto.identity.resolveHandle?handle=%s", handle);
+      JsonDocument doc(&arena);
+      if (!fetchJson(url, doc, didFilter()))
+      {
+        return false;
+      }
+      const char *value = doc["did"] | "";
+      if (strncmp(value, "did:", 4) != 0 || strlen(value) > MAX_DID_LENGTH)
+      {
+        LOG_WARN("%s: no usable DID for %s", getDisplayName(), handle);
+        return false;
+      }
+      strcpy(resolved, value);
+    }
+
+    if (strncmp(resolved, "did:plc:", 8) == 0)
+    {
+      snprintf(url, sizeof(url), "https://plc.directory/%s", resolved);
+    }
+    else if (strncmp(resolved, "did:web:", 8) == 0)
+    {
+      snprintf(url, sizeof(url), "https://%s/.well-known/did.json", resolved + 8);
+    }
+    else
+    {
+      LOG_WARN("%s: unsupported DID method in %s", getDisplayName(), resolved);
+      return false;
+    }
+
+    JsonDocument doc(&arena);
+    if (!fetchJson(url, doc, serviceFilter()))
+    {
+      return false;
+    }
+
+    const char *endpoint = nullptr;
+    for (JsonObjectConst service : doc["service"].as<JsonArrayConst>())
+    {
+      // The id is "#atproto_pds", or the same fragment on the full DID
+      const char *id = service["id"] | "";
+      const char *fragment = strchr(id, '#');
+      if (fragment != nullptr && strcmp(fragment, "#atproto_pds") == 0 &&
+          strcmp(service["type"] | "", "AtprotoPersonalDataServer") == 0)
+      {
+        endpoint = service["serviceEndpoint"];
+        break;
+      }
+    }
+
+    size_t endpointLength = endpoint != nullptr ? strlen(endpoint) : 0;
+    while (endpointLength > 0 && endpoint[endpointLength - 1] == '/')
+    {
+      endpointLength--;
+    }
+    if (endpointLength <= 8 || endpointLength > MAX_PDS_URL_LENGTH || strncmp(endpoint, "https://", 8) != 0)
+    {
+      LOG_WARN("%s: no usable PDS for %s", getDisplayName(), resolved);
+      return false;
+    }
+
+    strcpy(did, resolved);
+    memcpy(pdsUrl, endpoint, endpointLength);
+    pdsUrl[endpointLength] = '\0';
+    LOG_INFO("%s: %s is %s on %s", getDisplayName(), handle, did, pdsUrl);
+    return true;
+  }
+
+  // Validators from one server mean nothing to another
+  void forgetIdentity()
+  {
+    LOG_WARN("%s: dropping cached PDS %s", getDisplayName(), pdsUrl);
+    did[0] = '\0';
+    pdsUrl[0] = '\0';
+    clearValidators();
+  }
+
+public:
+  static constexpr uint32_t DEFAULT_POLL_INTERVAL = 300;
+
+  BlueskyPollingTimer(const char *displayName,
+                      const char *userHandle,
+                      uint32_t pollInterval = DEFAULT_POLL_INTERVAL,
+                      time_t initialTime = time(nullptr))
+      : PollingTimer(displayName, pollInterval, initialTime)
+  {
+    LOG_DEBUG("Starting Bluesky timer constructor");
+
+    // Check handle length before copying
+    if (strlen(userHandle) > MAX_HANDLE_LENGTH)
+    {
+      LOG_ERROR("Bluesky handle exceeds maximum length of 253 characters");
+      throw std::invalid_argument("Bluesky handle too long");
+    }
+
+    strcpy(handle, userHandle);
+    handle[sizeof(handle) - 1] = '\0';
+    did[0] = '\0';
+    pdsUrl[0] = '\0';
+    resolveAfter = 0;
+  }
+
+  void saveState(TimerState &state) const override
+  {
+    PollingTimer::saveState(state);
+    memcpy(state.provider.bluesky.did, did, sizeof(state.provider.bluesky.did));
+    memcpy(state.provider.bluesky.pdsUrl, pdsUrl, sizeof(state.provider.bluesky.pdsUrl));
+  }
+
+  void restoreState(const TimerState &state) override
+  {
+    PollingTimer::restoreState(state);
+    memcpy(did, state.provider.bluesky.did, sizeof(did));
+    memcpy(pdsUrl, state.provider.bluesky.pdsUrl, sizeof(pdsUrl));
+    did[sizeof(did) - 1] = '\0';
+    pdsUrl[sizeof(pdsUrl) - 1] = '\0';
+    if (did[0] == '\0' || pdsUrl[0] == '\0')
+    {
+      did[0] = '\0';
+      pdsUrl[0] = '\0';
+    }
+  }
+
+  // Resolution itself is rare enough to go without
+  void addHosts(DnsCache &dns) const override
+  {
+    char host[DNS_HOST_LENGTH + 1];
+    dns.remember(did[0] != '\0' && hostFromUrl(pdsUrl, host, sizeof(host)) ? host : "bsky.social");
+  }
+
+protected:
+  bool pollImpl(JsonArena &arena) override
+  {
+    LOG_DEBUG("Starting Bluesky poll");
+    if (WiFi.status() != WL_CONNECTED)
+    {
+      LOG_WARN("WiFi not connected");
+      return false;
+    }
+
+    bool direct = did[0] != '\0';
+    if (!direct && time(nullptr) >= resolveAfter)
+    {
+      direct = resolveIdentity(arena);
+      resolveAfter = direct ? 0 : time(nullptr) + RESOLVE_RETRY_INTERVAL;
+    }
+
+    // Records come newest first unless reverse=true, so a single record is
+    // the latest post
+    char url[64 + MAX_HANDLE_LENGTH + 48];
+    if (direct)
+    {
+      snprintf(url, sizeof(url), "%s/xrpc/com.atproto.repo.listRecords?repo=%s&collection=app.bsky.feed.post&limit=1",
+               pdsUrl, did);
+    }
+    else
+    {
+      snprintf(url, sizeof(url), "https://bsky.social/xrpc/com.atproto.repo.listRecords?repo=%s&collection=app.bsky.feed.post&limit=1", handle);
+    }
+    LOG_DEBUG("Polling URL: %s", url);
+
+    PooledRequest http(connectionPool);
+    if (!http.begin(url))
+    {
+      LOG_ERROR("HTTP begin failed");
+      return false;
+    }
+
+    int httpCode = sendGet(http);
+    LOG_DEBUG("HTTP Response code: %d", httpCode);
+    bool success = httpCode == HTTP_CODE_NOT_MODIFIED;
+
+    if (httpCode == HTTP_CODE_OK)
+    {
+      JsonDocument doc(&arena);
+      DeserializationError error = parseBody(http, doc, recordFilter());
+
+      if (error)
+      {
+        LOG_ERROR("JSON parse error: %s", error.c_str());
+      }
+
+      if (!error && doc["records"][0]["value"]["createdAt"])
+      {
+        const char *dateStr = doc["records"][0]["value"]["createdAt"];
+        LOG_DEBUG("Found date string: %s", dateStr);
+        int64_t eventTime;
+        if (parseIso8601(dateStr, eventTime))
+        {
+          trigger(eventTime);
+          storeValidators(http);
+          success = true;
+        }
+      }
+    }
+
+    http.end();
+
+    // Rate limiting is not a sign the account moved
+    bool moved = httpCode >= 400 && httpCode < 500 && httpCode != HTTP_CODE_TOO_MANY_REQUESTS;
+    bool unreachable = httpCode <= 0 && consecutiveFailures() + 1 >= RESOLVE_AFTER_FAILURES;
+    if (direct && (moved || unreachable))
+    {
+      forgetIdentity();
+    }
+    return success;
+  }
+};
+
+class WeatherPollingTimer final : public PollingTimer
+{
+private:
+  float latitude;
+  float longitude;
+  float currentTemp;
+  time_t historyCoveredUntil; // Hourly history has been scanned up to here; 0 if never
+  time_t forecastThawAt;      // First forecast hour near zero while below it; 0 if unknown
+  char displayName[32]; // Store the full display name here
+  static const uint32_t HISTORY_LOOKBACK = 30 * 24 * 60 * 60; // Get at most 30 days of history
+  static const uint8_t FORECAST_HOURS = 48;                     // Looked ahead by adaptive timers
+  static constexpr float FORECAST_MARGIN = 2.0f;                // Forecasts within this of zero count as a thaw
+
+  // Consecutive polls overlap, so history is only needed after a gap such as
+  // a power cut or outage. The gap is then fetched as hourly data in the
+  // same forecast request rather than re-reading a fixed archive window.
+  bool needsHistory(time_t now) const
+  {
+    return historyCoveredUntil == 0 || now - historyCoveredUntil > 2 * (time_t)getPollingInterval();
+  }
+
+  static const JsonDocument &currentFilter()
+  {
+    static const JsonDocument filter = []
+    {
+      JsonDocument doc;
+      doc["current"]["temperature_2m"] = true;
+      return doc;
+    }();
+    return filter;
+  }
+
+  static const JsonDocument &historyFilter()
+  {
+    static const JsonDocument filter = []
+    {
+      JsonDocument doc;
+      doc["current"]["temperature_2m"] = true;
+      doc["hourly"]["time"] = true;
+      doc["hourly"]["temperature_2m"] = true;
+      return doc;
+    }();
+    return filter;
+  }
+
+  // Scans the returned hours newest first for the latest one above zero
+  void applyHistory(JsonDocument &doc, time_t startTime)
+  {
+    JsonArray times = doc["hourly"]["time"];
+    JsonArray temps = doc["hourly"]["temperature_2m"];
+
+    time_t now = time(nullptr);
+    for (int i = times.size() - 1; i >= 0; i--)
+    {
+      float temp = temps[i];
+
+      // Adaptive timers ask for forecast hours too
+      if (temp > 0.0f && times[i].as<int64_t>() <= now)
+      {
+        // Requested with timeformat=unixtime, so no date parsing is needed
+        time_t aboveZero = times[i].as<int64_t>();
+        if (aboveZero > getLastTriggerTime() || historyCoveredUntil == 0)
+        {
+          trigger(aboveZero);
+        }
+        return;
+      }
+    }
+
+    // Never above zero in the whole lookback window
+    if (historyCoveredUntil == 0)
+    {
+      trigger(startTime);
+    }
+  }
+
+  // While below zero, finds when it could next go above, allowing for the
+  // forecast being off by FORECAST_MARGIN. Without such an hour the whole
+  // forecast stays cold and its end is the earliest thaw.
+  void applyForecast(JsonDocument &doc, time_t now)
+  {
+    JsonArray times = doc["hourly"]["time"];
+    JsonArray temps = doc["hourly"]["temperature_2m"];
+    forecastThawAt = 0;
+    if (currentTemp > 0.0f)
+    {
+      return;
+    }
+
+    for (size_t i = 0; i < times.size(); i++)
+    {
+      time_t hour = times[i].as<int64_t>();
+      if (hour <= now)
+      {
+        continue;
+      }
+      forecastThawAt = hour;
+      if (temps[i].as<float>() > -FORECAST_MARGIN)
+      {
+        return;
+      }
+    }
+  }
+
+  // Every poll above zero triggers, so only a cold spell can stretch the
+  // interval: polls halve the time left until the forecast thaw
+  uint32_t suggestInterval(time_t now) const override
+  {
+    if (currentTemp > 0.0f || forecastThawAt <= now)
+    {
+      return getPollingInterval();
+    }
+    return (forecastThawAt - now) / 2;
+  }
+
+public:
+  static constexpr uint32_t DEFAULT_POLL_INTERVAL = 900; // 15 minutes
+
+  WeatherPollingTimer(const char *displayName,
+                      float lat, float lon,
+                      uint32_t pollInterval = DEFAULT_POLL_INTERVAL)
+      : PollingTimer(displayName, pollInterval, time(nullptr)),
+        latitude(lat), longitude(lon), currentTemp(0.0f), historyCoveredUntil(0), forecastThawAt(0) {}
+
+  void saveState(TimerState &state) const override
+  {
+    PollingTimer::saveState(state);
+    state.provider.weather.historyCoveredUntil = historyCoveredUntil;
+    state.provider.weather.currentTemp = currentTemp;
+  }
+
+  void restoreState(const TimerState &state) override
+  {
+    PollingTimer::restoreState(state);
+    historyCoveredUntil = state.provider.weather.historyCoveredUntil;
+    // Restored with the validators, so a 304 straight after boot still knows whether it is warm
+    currentTemp = state.provider.weather.currentTemp;
+  }
+
+  void addHosts(DnsCache &dns) const override
+  {
+    dns.remember("api.open-meteo.com");
+  }
+
+  // Every poll above zero triggers, so its history would only repeat the poll interval
+  bool keepsHistory() const override { return false; }
+
+protected:
+  bool pollImpl(JsonArena &arena) override
+  {
+    LOG_DEBUG("Starting Weather poll");
+    if (WiFi.status() != WL_CONNECTED)
+    {
+      LOG_WARN("WiFi not connected");
+      return false;
+    }
+
+    time_t now = time(nullptr);
+    bool withHistory = needsHistory(now);
+    bool withForecast = isAdaptive();
+    bool withHourly = withHistory || withForecast;
+    time_t startTime = now - HISTORY_LOOKBACK;
+    if (withHistory && historyCoveredUntil > startTime)
+    {
+      startTime = historyCoveredUntil;
+    }
+
+    PooledRequest http(connectionPool);
+    char url[256];
+    int length = snprintf(url, sizeof(url),
+                          "https://api.open-meteo.com/v1/forecast?"
+                          "latitude=%.4f&longitude=%.4f"
+                          "&current=temperature_2m",
+                          latitude, longitude);
+
+    if (withHistory)
+    {
+      // Format the hour range for Open-Meteo
+      struct tm timeinfo;
+      char startHour[17], endHour[17];
+      time_t endTime = withForecast ? now + FORECAST_HOURS * 3600 : now;
+      gmtime_r(&startTime, &timeinfo);
+      strftime(startHour, sizeof(startHour), "%Y-%m-%dT%H:00", &timeinfo);
+      gmtime_r(&endTime, &timeinfo);
+      strftime(endHour, sizeof(endHour), "%Y-%m-%dT%H:00", &timeinfo);
+
+      // Unix times are shorter on the wire than ISO strings and need no parsing
+      snprintf(url + length, sizeof(url) - length,
+               "&hourly=temperature_2m&timeformat=unixtime&start_hour=%s&end_hour=%s",
+               startHour, endHour);
+    }
+    else if (withForecast)
+    {
+      snprintf(url + length, sizeof(url) - length,
+               "&hourly=temperature_2m&timeformat=unixtime&forecast_hours=%u", (unsigned)FORECAST_HOURS);
+    }
+
+    LOG_DEBUG("Polling URL: %s", url);
+
+    if (!http.begin(url))
+    {
+      LOG_ERROR("HTTP begin failed");
+      return false;
+    }
+
+    // History requests are one-offs, so only the steady-state query is conditional
+    int httpCode = sendGet(http, !withHistory);
+    LOG_DEBUG("HTTP Response code: %d", httpCode);
+    bool success = false;
+
+    if (httpCode == HTTP_CODE_NOT_MODIFIED)
+    {
+      // Last reading is still current
+      if (currentTemp > 0.0f)
+      {
+        trigger(now);
+      }
+      historyCoveredUntil = now;
+      success = true;
+    }
+    else if (httpCode == HTTP_CODE_OK)
+    {
+      JsonDocument doc(&arena);
+      DeserializationError error = parseBody(http, doc, withHourly ? historyFilter() : currentFilter());
+
+      if (error)
+      {
+        LOG_ERROR("JSON parse error: %s", error.c_str());
+      }
+
+      bool historyOk = !withHourly || (doc["hourly"]["time"].is<JsonArray>() &&
+                                       doc["hourly"]["temperature_2m"].is<JsonArray>());
+      if (!error && historyOk && doc["current"]["temperature_2m"].is<float>())
+      {
+        if (withHistory)
+        {
+          applyHistory(doc, startTime);
+        }
+
+        currentTemp = doc["current"]["temperature_2m"];
+        LOG_DEBUG("Current temperature: %.1f°C", currentTemp);
+        if (withForecast)
+        {
+          applyForecast(doc, now);
+        }
+
+        if (currentTemp > 0.0f)
+        {
+          LOG_DEBUG("Temperature above 0°C, updating trigger time");
+          trigger(now);
+        }
+        historyCoveredUntil = now;
+        if (!withHistory)
+        {
+          storeValidators(http);
+        }
+        success = true;
+      }
+    }
+
+    http.end();
+    return success;
+  }
+};
+
+#endif
@@ -0,0 +1,281 @@
+#ifndef TRIGGER_HISTORY_H
+#define TRIGGER_HISTORY_H
+
+#include <Arduino.h>
+#include <algorithm>
+
+#define TRIGGER_HISTORY_SIZE 32
+#define TRIGGER_HISTORY_FORMAT 1
+// Format byte, count, oldest time and each delta as varints, then the aggregates
+#define TRIGGER_HISTORY_ENCODED_MAX (1 + 5 + 5 * TRIGGER_HISTORY_SIZE + 10 + 5 * 3 + 3 * 2)
+
+// The most recent trigger times of one timer, plus aggregates over every
+// trigger it has seen. The aggregates are updated as each trigger arrives,
+// so reading them never walks the ring. A trigger at or before the newest
+// one already recorded, such as a poll reporting the same event again, is
+// ignored. Streaks count consecutive UTC days with at least one trigger.
+//
+// In flash the ring is stored as its oldest time followed by the gap to each
+// later one, all as LEB128 varints, so a typical history of hour-to-day gaps
+// takes three bytes per entry instead of eight.
+//
+// record() may be called from any task; the lock is held only for O(1) work,
+// or for one pass over TRIGGER_HISTORY_SIZE entries when encoding.
+class TriggerHistory
+{
+public:
+  struct Stats
+  {
+    uint32_t events;     // Every trigger recorded, not just those still in the ring
+    uint32_t meanGap;    // Over every gap; 0 with fewer than two triggers
+    uint32_t recentGap;  // Mean over the gaps still in the ring
+    uint32_t maxGap;     // Longest gap ever seen
+    uint16_t streak;     // Current run of days, 0 once a whole day passes without a trigger
+    uint16_t bestStreak;
+  };
+
+private:
+  mutable portMUX_TYPE lock;
+  uint32_t times[TRIGGER_HISTORY_SIZE]; // Epoch seconds; fits until 2106
+  uint8_t head;                         // Where the next time goes
+  uint8_t count;
+  uint32_t events;
+  uint64_t gapSum;
+  uint32_t maxGap;
+  uint32_t streakDay; // Day of the newest trigger
+  uint16_t streak;
+  uint16_t bestStreak;
+  uint32_t revision; // Bumped on every change, so unchanged histories are not rewritten
+  uint32_t savedRevision;
+
+  uint32_t newest() const
+  {
+    return times[(head + TRIGGER_HISTORY_SIZE - 1) % TRIGGER_HISTORY_SIZE];
+  }
+
+  uint32_t oldest() const
+  {
+    return times[(head + TRIGGER_HISTORY_SIZE - count) % TRIGGER_HISTORY_SIZE];
+  }
+
+  void clearLocked()
+  {
+    head = 0;
+    count = 0;
+    events = 0;
+    gapSum = 0;
+    maxGap = 0;
+    streakDay = 0;
+    streak = 0;
+    bestStreak = 0;
+  }
+
+  static size_t putVarint(uint8_t *out, uint64_t value)
+  {
+    size_t length = 0;
+    do
+    {
+      uint8_t byte = value & 0x7F;
+      value >>= 7;
+      out[length++] = byte | (value != 0 ? 0x80 : 0);
+    } while (value != 0);
+    return length;
+  }
+
+  static bool getVarint(const uint8_t *data, size_t size, size_t &offset, uint64_t &value)
+  {
+    value = 0;
+    for (uint8_t shift = 0; shift < 64 && offset < size; shift += 7)
+    {
+      uint8_t byte = data[offset++];
+      value |= (uint64_t)(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0)
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+public:
+  TriggerHistory() : revision(0), savedRevision(0)
+  {
+    portMUX_INITIALIZE(&lock);
+    clearLocked();
+  }
+
+  void record(time_t time)
+  {
+    if (time <= 0 || time > (time_t)UINT32_MAX)
+    {
+      return;
+    }
+
+    portENTER_CRITICAL(&lock);
+    uint32_t at = (uint32_t)time;
+    if (count == 0 || at > newest())
+    {
+      if (count > 0)
+      {
+        uint32_t gap = at - newest();
+        gapSum += gap;
+        maxGap = std::max(maxGap, gap);
+      }
+
+      uint32_t day = at / 86400;
+      if (streak == 0 || day > streakDay + 1)
+      {
+        streak = 1;
+      }
+      else if (day == streakDay + 1)
+      {
+        streak++;
+      }
+      streakDay = day;
+      bestStreak = std::max(bestStreak, streak);
+
+      times[head] = at;
+      head = (head + 1) % TRIGGER_HISTORY_SIZE;
+      count = std::min<uint8_t>(count + 1, TRIGGER_HISTORY_SIZE);
+      events++;
+      revision++;
+    }
+    portEXIT_CRITICAL(&lock);
+  }
+
+  // The clock was corrected by delta; moves triggers taken on the old clock.
+  // Aggregates keep the gap across the correction as it was first measured.
+  void reanchor(time_t since, int32_t delta)
+  {
+    portENTER_CRITICAL(&lock);
+    for (uint8_t i = 0; i < count; i++)
+    {
+      uint32_t &at = times[(head + TRIGGER_HISTORY_SIZE - count + i) % TRIGGER_HISTORY_SIZE];
+      if ((time_t)at >= since)
+      {
+        at += delta;
+      }
+    }
+    revision++;
+    portEXIT_CRITICAL(&lock);
+  }
+
+  Stats stats(time_t now) const
+  {
+    portENTER_CRITICAL(&lock);
+    Stats result = {events, 0, 0, maxGap, streak, bestStreak};
+    if (events >= 2)
+    {
+      result.meanGap = (uint32_t)(gapSum / (events - 1));
+    }
+    if (count >= 2)
+    {
+      result.recentGap = (newest() - oldest()) / (count - 1);
+    }
+    // Yesterday's trigger still counts until today is over
+    if (count == 0 || (uint32_t)(now / 86400) > streakDay + 1)
+    {
+      result.streak = 0;
+    }
+    portEXIT_CRITICAL(&lock);
+    return result;
+  }
+
+  uint8_t size() const
+  {
+    return count;
+  }
+
+  // index 0 is the oldest time still held
+  time_t at(uint8_t index) const
+  {
+    portENTER_CRITICAL(&lock);
+    time_t value = index < count ? times[(head + TRIGGER_HISTORY_SIZE - count + index) % TRIGGER_HISTORY_SIZE] : 0;
+    portEXIT_CRITICAL(&lock);
+    return value;
+  }
+
+  // Returns the encoded length, or 0 if nothing changed since markSaved(). out
+  // needs TRIGGER_HISTORY_ENCODED_MAX bytes.
+  size_t encodeIfChanged(uint8_t *out, uint32_t &encodedRevision) const
+  {
+    portENTER_CRITICAL(&lock);
+    if (revision == savedRevision)
+    {
+      portEXIT_CRITICAL(&lock);
+      return 0;
+    }
+
+    size_t length = 0;
+    out[length++] = TRIGGER_HISTORY_FORMAT;
+    length += putVarint(out + length, count);
+    uint32_t previous = 0;
+    for (uint8_t i = 0; i < count; i++)
+    {
+      uint32_t at = times[(head + TRIGGER_HISTORY_SIZE - count + i) % TRIGGER_HISTORY_SIZE];
+      length += putVarint(out + length, at - previous);
+      previous = at;
+    }
+    length += putVarint(out + length, events);
+    length += putVarint(out + length, gapSum);
+    length += putVarint(out + length, maxGap);
+    length += putVarint(out + length, streakDay);
+    length += putVarint(out + length, streak);
+    length += putVarint(out + length, bestStreak);
+    encodedRevision = revision;
+    portEXIT_CRITICAL(&lock);
+    return length;
+  }
+
+  void markSaved(uint32_t encodedRevision)
+  {
+    portENTER_CRITICAL(&lock);
+    savedRevision = encodedRevision;
+    portEXIT_CRITICAL(&lock);
+  }
+
+  // Replaces the history; on a malformed blob it is left empty
+  bool decode(const uint8_t *data, size_t size)
+  {
+    uint32_t decoded[TRIGGER_HISTORY_SIZE];
+    uint64_t fields[7];
+    size_t offset = 1;
+    bool valid = size > 0 && data[0] == TRIGGER_HISTORY_FORMAT && getVarint(data, size, offset, fields[0]) &&
+                 fields[0] <= TRIGGER_HISTORY_SIZE;
+
+    uint64_t previous = 0;
+    for (uint8_t i = 0; valid && i < fields[0]; i++)
+    {
+      uint64_t delta;
+      valid = getVarint(data, size, offset, delta) && (delta > 0 || i == 0) && previous + delta <= UINT32_MAX;
+      previous += delta;
+      decoded[i] = (uint32_t)previous;
+    }
+    for (uint8_t i = 1; valid && i < 7; i++)
+    {
+      valid = getVarint(data, size, offset, fields[i]);
+    }
+    valid = valid && offset == size;
+
+    portENTER_CRITICAL(&lock);
+    clearLocked();
+    if (valid)
+    {
+      count = (uint8_t)fields[0];
+      memcpy(times, decoded, count * sizeof(uint32_t));
+      head = count % TRIGGER_HISTORY_SIZE;
+      events = (uint32_t)fields[1];
+      gapSum = fields[2];
+      maxGap = (uint32_t)fields[3];
+      streakDay = (uint32_t)fields[4];
+      streak = (uint16_t)fields[5];
+      bestStreak = (uint16_t)fields[6];
+    }
+    // What was just read is what flash holds
+    savedRevision = revision;
+    portEXIT_CRITICAL(&lock);
+    return valid;
+  }
+};
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef WIFI_MANAGER_H
+#define WIFI_MANAGER_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <algorithm>
+#include <atomic>
+#include "logger.h"
+
+#define WIFI_CONNECT_TIMEOUT_MS 20000
+#define WIFI_RETRY_MIN_MS 2000
+#define WIFI_RETRY_MAX_MS (5 * 60 * 1000)
+
+// Keeps the station connected without ever blocking the caller. WiFi events
+// only set flags and wake the UI task; update() runs the state machine on the
+// UI task and retries with jittered exponential backoff after a failed
+// attempt or a dropped link. Connectivity edges are handed out once through
+// takeChange() so the scheduler can pause and resume polling.
+class WifiManager
+{
+private:
+  enum State
+  {
+    WIFI_IDLE,
+    WIFI_CONNECTING,
+    WIFI_CONNECTED,
+    WIFI_BACKOFF
+  };
+
+  const char *ssid;
+  const char *password;
+  State state;
+  unsigned long attemptStartMs;
+  unsigned long backoffStartMs;
+  uint32_t backoffMs; // Doubles per failure up to WIFI_RETRY_MAX_MS
+  uint32_t waitMs;    // Jittered wait for the current backoff
+  bool reportedConnected;
+  std::atomic<bool> linkUp;
+  TaskHandle_t notifyTask;
+
+  void startAttempt(unsigned long nowMs)
+  {
+    LOG_INFO("Connecting to WiFi %s", ssid);
+    WiFi.disconnect();
+    WiFi.begin(ssid, password);
+    state = WIFI_CONNECTING;
+    attemptStartMs = nowMs;
+  }
+
+  void startBackoff(unsigned long nowMs)
+  {
+    // Jitter keeps several units from hammering the AP in lockstep after an outage
+    waitMs = backoffMs / 2 + esp_random() % (backoffMs / 2 + 1);
+    backoffMs = std::min<uint32_t>(backoffMs * 2, WIFI_RETRY_MAX_MS);
+    backoffStartMs = nowMs;
+    state = WIFI_BACKOFF;
+    LOG_WARN("WiFi retry in %u ms", (unsigned)waitMs);
+  }
+
+  void onEvent(arduino_event_id_t event)
+  {
+    switch (event)
+    {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+      linkUp.store(true);
+      break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+    case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+      linkUp.store(false);
+      break;
+    default:
+      return;
+    }
+
+    if (notifyTask != nullptr)
+    {
+      xTaskNotifyGive(notifyTask);
+    }
+  }
+
+public:
+  WifiManager()
+      : ssid(nullptr), password(nullptr), state(WIFI_IDLE), attemptStartMs(0), backoffStartMs(0),
+        backoffMs(WIFI_RETRY_MIN_MS), waitMs(0), reportedConnected(false), linkUp(false),
+        notifyTask(nullptr) {}
+
+  // Starts the first attempt and returns at once; events wake the calling task
+  void begin(const char *networkSsid, const char *networkPassword)
+  {
+    ssid = networkSsid;
+    password = networkPassword;
+    notifyTask = xTaskGetCurrentTaskHandle();
+
+    WiFi.mode(WIFI_STA);
+    WiFi.setAutoReconnect(false); // Reconnects are paced by the backoff below
+    WiFi.onEvent([this](arduino_event_id_t event, arduino_event_info_t)
+                 { onEvent(event); });
+    startAttempt(millis());
+  }
+
+  void update(unsigned long nowMs)
+  {
+    bool up = linkUp.load();
+
+    switch (state)
+    {
+    case WIFI_IDLE:
+      break;
+    case WIFI_CONNECTING:
+      if (up)
+      {
+        LOG_INFO("WiFi connected, IP address: %s", WiFi.localIP().toString().c_str());
+        state = WIFI_CONNECTED;
+        backoffMs = WIFI_RETRY_MIN_MS;
+      }
+      else if (nowMs - attemptStartMs >= WIFI_CONNECT_TIMEOUT_MS)
+      {
+        LOG_WARN("WiFi connect timed out");
+        WiFi.disconnect();
+        startBackoff(nowMs);
+      }
+      break;
+    case WIFI_CONNECTED:
+      if (!up)
+      {
+        LOG_WARN("WiFi connection lost");
+        startBackoff(nowMs);
+      }
+      break;
+    case WIFI_BACKOFF:
+      if (up)
+      {
+        state = WIFI_CONNECTED;
+        backoffMs = WIFI_RETRY_MIN_MS;
+      }
+      else if (nowMs - backoffStartMs >= waitMs)
+      {
+        startAttempt(nowMs);
+      }
+      break;
+    }
+  }
+
+  bool isConnected() const
+  {
+    return state == WIFI_CONNECTED;
+  }
+
+  // Reports each connect or disconnect once, after update() has seen it
+  bool takeChange(bool &connected)
+  {
+    bool nowConnected = isConnected();
+    if (nowConnected == reportedConnected)
+    {
+      return false;
+    }
+    reportedConnected = nowConnected;
+    connected = nowConnected;
+    return true;
+  }
+};
+
+#endif